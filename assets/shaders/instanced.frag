@@ -1,6 +1,7 @@
 #version 330 core
+in vec4 Color;
 out vec4 FragColor;
 
 void main() {
-  FragColor = vec4(0.f, 0.7f, 1.f, 0.2f);
+  FragColor = Color;
 }
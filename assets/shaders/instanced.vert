@@ -0,0 +1,18 @@
+#version 330 core
+layout (std140) uniform Matrices
+{
+  mat4 projection;
+  mat4 view;
+};
+
+layout (location = 0) in vec3 pos;
+// Per instance
+layout (location = 1) in mat4 model;
+layout (location = 5) in vec4 color;
+
+out vec4 Color;
+
+void main() {
+  gl_Position = projection * view * model * vec4(pos, 1.0);
+  Color = color;
+}
@@ -4,7 +4,10 @@ layout (std140) uniform Matrices
   mat4 projection;
   mat4 view;
 };
-uniform float time;
+layout (std140) uniform Frame
+{
+  float time;
+};
 
 in vec3 FragPos;
 in vec3 Normal;
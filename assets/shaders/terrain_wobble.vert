@@ -0,0 +1,34 @@
+#version 330 core
+layout (std140) uniform Matrices
+{
+  mat4 projection;
+  mat4 view;
+};
+// Same falloff as Terrain::update, see WobblesBlock
+layout (std140) uniform Wobbles
+{
+  int numWobbles;
+  vec4 wobbles[256];
+};
+uniform mat4 model;
+
+layout (location = 0) in vec3 aPos;
+
+out vec3 FragPos;
+out vec3 Normal;
+
+void main() {
+  vec3 pos = aPos;
+
+  // Vertices alternate surface, bottom. Only the surface wobbles.
+  if (gl_VertexID % 2 == 0) {
+    for (int i = 0; i < numWobbles; ++i) {
+      float dx = abs(pos.x - wobbles[i].x);
+      if (dx <= wobbles[i].z) pos.y += wobbles[i].y * exp(-dx / 200.0);
+    }
+  }
+
+  gl_Position = projection * view * model * vec4(pos, 1.0);
+  FragPos = vec3(model * vec4(pos, 1.0));
+  Normal = vec3(0.0, 0.0, 1.0);
+}
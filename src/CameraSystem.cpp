@@ -4,26 +4,37 @@
 #include <iostream>
 
 #include "EventManager.hpp"
-#include "Random.hpp"
 #include "Window.hpp"
 #include "PlayerSystem.hpp"
 #include "ResourceManager.hpp"
+#include "Snapshot.hpp"
 
 #include <numeric>
 #include "Grenade.hpp"
 
 CameraSystem::CameraSystem(const Window* w, const std::vector<Player>& p) :
   window(w),
+  shakeRandom(Random::stream(Random::CAMERA)),
   players(p)
 {
   fov = 60.f;
 
   shakeAmplitude = 0.f;
   shakeStartTimestamp = 0.f;
+
+  explosionHandle = EventManager::Register<EvdGrenadeExplosion>(
+      std::bind(&CameraSystem::onExplosion, this, _1, _2), this);
+}
+
+CameraSystem::~CameraSystem()
+{
+  EventManager::Unregister(explosionHandle);
 }
 
 void CameraSystem::update(double t, double dt)
 {
+  previousPosition = position;
+
   if (players.size() == 0) return;
 
   glm::vec2 minPlayerBounds{
@@ -65,19 +76,18 @@ void CameraSystem::update(double t, double dt)
 
   // Camera shake
   float shakeAmount = shakeAmplitude * glm::exp(-6.f*(t-shakeStartTimestamp));
-  position.x += Random::randomFloat(-shakeAmount, shakeAmount);
-  position.y += Random::randomFloat(-shakeAmount, shakeAmount);
-
-  EventManager::Register(Event::EXPLOSION,
-      std::bind(&CameraSystem::onExplosion, this, _1));
+  position.x += shakeRandom.randomFloat(-shakeAmount, shakeAmount);
+  position.y += shakeRandom.randomFloat(-shakeAmount, shakeAmount);
 }
 
-glm::mat4 CameraSystem::getView() const
+glm::mat4 CameraSystem::GetView(const Snapshot& s, float alpha)
 {
+  glm::vec3 p = glm::mix(s.cameraPreviousPosition, s.cameraPosition, alpha);
+
   glm::mat4 view;
   view = glm::lookAt(
-      position,
-      glm::vec3(position.x, position.y, 0.f),
+      p,
+      glm::vec3(p.x, p.y, 0.f),
       glm::vec3(0.f, 1.f, 0.f));
 
   return view;
@@ -94,10 +104,11 @@ glm::mat4 CameraSystem::getProjection() const
   return projection;
 }
 
-void CameraSystem::onExplosion(const Event& e)
+void CameraSystem::onExplosion(const Event& e, const EvdGrenadeExplosion& d)
 {
-  auto g = boost::any_cast<EvdGrenadeExplosion>(e.data).grenade;
-  if (g->properties.radius == 0.f) return;
+  const auto& properties = Grenade::getProperties(d.type);
+
+  if (properties.radius == 0.f) return;
 
   shakeAmplitude = 2.f;
   shakeStartTimestamp = e.timestamp;
@@ -4,21 +4,33 @@
 #include <glm/matrix.hpp>
 #include <glm/vec2.hpp>
 
+#include "EventManager.hpp"
+#include "Random.hpp"
+
 struct Event;
 class Window;
 struct Player;
+struct Snapshot;
 
 class CameraSystem
 {
 public:
   CameraSystem(const Window*, const std::vector<Player>&);
+  ~CameraSystem();
   void update(double t, double dt);
 
-  glm::mat4 getView() const;
+  glm::vec3 getPosition() const { return position; }
+  glm::vec3 getPreviousPosition() const { return previousPosition; }
+
+  // View of the camera state published in a snapshot. alpha blends from
+  // the previous tick's position to the current one.
+  static glm::mat4 GetView(const Snapshot&, float alpha = 1.f);
+  // Only reads the window, safe to call while update() runs elsewhere
   glm::mat4 getProjection() const;
 
 private:
   glm::vec3 position;
+  glm::vec3 previousPosition;
   glm::vec2 rotation;
 
   const Window* window;
@@ -27,8 +39,12 @@ private:
 
   float shakeAmplitude;
   float shakeStartTimestamp;
+  // Own stream, so shake doesn't change the gameplay sequence and
+  // replays play back the same without a camera
+  RandomStream shakeRandom;
   
   const std::vector<Player>& players;
 
-  void onExplosion(const Event&);
+  void onExplosion(const Event&, const EvdGrenadeExplosion&);
+  EventManager::Handle explosionHandle;
 };
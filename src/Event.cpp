@@ -1,7 +1,5 @@
 #include "Event.hpp"
 
-#include <GLFW/glfw3.h>
-
 Event::Event(Type t) :
   type(t)
 {
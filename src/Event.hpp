@@ -1,13 +1,11 @@
 #pragma once
 
-#include <boost/any.hpp>
 #include <vector>
 
 #include <glm/vec2.hpp>
 
-class Player;
-class Grenade;
-class Powerup;
+#include "Grenade.hpp"
+#include "Powerup.hpp"
 
 struct Event
 {
@@ -19,43 +17,68 @@ struct Event
     PLAYER_DETONATE_GRENADE,
     POWERUP_LAND,
     POWERUP_PICKUP,
-    EXPLOSION
+    EXPLOSION,
+    NUM_TYPES
   };
 
   Event(Type t);
 
   Type type;
   double timestamp;
-  boost::any data;
+};
+
+// Event payloads. Each is sent and listened for by type through
+// EventManager, TYPE ties it to its Event::Type.
+// Payloads are plain values rather than pointers into system storage, so
+// they stay valid when dispatch is deferred by EventManager's queued mode.
+
+// GAME_START
+struct EvdGameStart {
+  static constexpr Event::Type TYPE = Event::GAME_START;
 };
 
 // EXPLOSION
 struct EvdGrenadeExplosion {
-  const Grenade* grenade;
+  static constexpr Event::Type TYPE = Event::EXPLOSION;
+  // Resolves through GrenadeSystem::getGrenades until the grenade is
+  // removed at the start of the next grenade update
+  GrenadeHandle grenade;
+  Grenade::Type type;
+  int owner;
+  glm::vec2 position;
 };
 
 // POWERUP_LAND
 struct EvdPowerupLand {
-  const Powerup* powerup;
+  static constexpr Event::Type TYPE = Event::POWERUP_LAND;
+  Powerup powerup;
 };
 
 // POWERUP_PICKUP
 struct EvdPowerupPickup {
-  const Powerup* powerup;
-  const Player* player;
+  static constexpr Event::Type TYPE = Event::POWERUP_PICKUP;
+  Powerup powerup;
+  int playerID;
 };
 
 // PLAYER_DEATH
 struct EvdPlayerDeath {
-  const Player* player;
+  static constexpr Event::Type TYPE = Event::PLAYER_DEATH;
+  int playerID;
 };
 
 // PLAYER_THROW_GRENADE
 struct EvdPlayerThrowGrenade {
-  const Player* player;
+  static constexpr Event::Type TYPE = Event::PLAYER_THROW_GRENADE;
+  int playerID;
+  Grenade::Type grenadeType;
+  glm::vec2 position;
+  glm::vec2 velocity;
+  float aimDirection;
 };
 
 // PLAYER_DETONATE_GRENADE
 struct EvdPlayerDetonateGrenade {
-  const Player* player;
+  static constexpr Event::Type TYPE = Event::PLAYER_DETONATE_GRENADE;
+  int playerID;
 };
@@ -1,34 +1,95 @@
 #include "EventManager.hpp"
 
 #include <iostream>
+#include <cassert>
 
 // Statics
 double EventManager::time;
-
-std::map<Event::Type, std::vector<std::function<void(const Event&)> > >
-EventManager::funcs;
+unsigned int EventManager::nextID = 0;
+size_t EventManager::listenerCounts[Event::NUM_TYPES] = {};
+bool EventManager::queued = false;
+std::vector<EventManager::QueuedEvent> EventManager::queue;
+std::function<void(const EventManager::QueuedEvent&)> EventManager::recorder;
 
 void EventManager::Update(double t, double)
 {
   time = t;
 }
 
-void EventManager::Register(Event::Type type, std::function<void(const Event&)> func)
+void EventManager::Unregister(Handle handle)
+{
+  if (handle.remove != nullptr)
+    handle.remove(handle.id);
+}
+
+void EventManager::SetQueued(bool q)
+{
+  // Don't strand anything queued before switching back
+  if (queued && !q) Flush();
+
+  queued = q;
+}
+
+bool EventManager::IsQueued()
+{
+  return queued;
+}
+
+void EventManager::Flush()
+{
+  // Listeners may send more events, which can grow the queue while we walk
+  // it, so index rather than iterate and dispatch from a copy
+  for (size_t i = 0; i < queue.size(); ++i) {
+    QueuedEvent q = queue[i];
+
+    if (recorder) recorder(q);
+    q.dispatch(q.event, q.payload);
+  }
+
+  // Keeps its capacity, so steady state ticks don't allocate
+  queue.clear();
+}
+
+void EventManager::SetRecorder(std::function<void(const QueuedEvent&)> r)
+{
+  recorder = r;
+}
+
+size_t EventManager::GetListenerCount(Event::Type type)
+{
+  return listenerCounts[type];
+}
+
+size_t EventManager::GetListenerCount()
 {
-  funcs[type].push_back(func);
+  size_t count = 0;
+  for (size_t c : listenerCounts)
+    count += c;
+
+  return count;
 }
 
-void EventManager::Send(Event::Type t, boost::any d)
+void EventManager::OnRegister(Event::Type type, bool duplicate)
 {
-  Event e{t};
-  e.timestamp = time;
-  e.data = d;
+  listenerCounts[type]++;
+
+#ifndef NDEBUG
+  // Registering the same object twice is almost always a bug, typically a
+  // Register call that runs every frame instead of once
+  if (duplicate) {
+    std::cout << "Error: duplicate listener registered for event type "
+      << type << std::endl;
+    assert(false);
+  }
 
-  for (auto& func : funcs[e.type])
-    func(e);
+  if (listenerCounts[type] == LISTENER_WARNING_COUNT+1) {
+    std::cout << "Warning: " << listenerCounts[type]
+      << " listeners registered for event type " << type << std::endl;
+  }
+#endif
 }
 
-void EventManager::Send(Event::Type t)
+void EventManager::OnUnregister(Event::Type type)
 {
-  Send(t, NULL);
+  listenerCounts[type]--;
 }
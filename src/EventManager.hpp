@@ -2,7 +2,10 @@
 
 #include <functional>
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
 
 #include "Event.hpp"
 
@@ -11,16 +14,141 @@ using namespace std::placeholders;
 class EventManager
 {
 public:
+  // Identifies a registered listener, pass to Unregister to remove it
+  struct Handle {
+    Event::Type type;
+    unsigned int id;
+    void (*remove)(unsigned int id);
+  };
+
+  // Listener counts above this are reported in debug builds
+  static constexpr size_t LISTENER_WARNING_COUNT = 64;
+
+  // Largest payload that can be queued
+  static constexpr size_t MAX_PAYLOAD_SIZE = 256;
+
+  // An event waiting in the queue, payload bytes stored inline
+  struct QueuedEvent {
+    Event event;
+    size_t size;
+    void (*dispatch)(const Event&, const void* payload);
+    alignas(std::max_align_t) unsigned char payload[MAX_PAYLOAD_SIZE];
+  };
+
   static void Update(double t, double dt);
 
-  static void Register(Event::Type, std::function<void(const Event&)>);
+  // Listen for events carrying payload T (one of the Evd structs),
+  // f is called as f(const Event&, const T&).
+  // owner is only used to catch the same object registering twice.
+  template <typename T, typename F>
+    static Handle Register(F f, const void* owner = nullptr);
+  static void Unregister(Handle);
+
+  static size_t GetListenerCount(Event::Type);
+  static size_t GetListenerCount();
+
+  // Event type is taken from T::TYPE
+  template <typename T>
+    static void Send(const T&);
+
+  // In queued mode Send only appends to the queue, listeners are called
+  // when Flush runs. Events sent by listeners during a Flush are
+  // dispatched by that same Flush, after everything queued before them.
+  static void SetQueued(bool);
+  static bool IsQueued();
+  static void Flush();
+
+  // Called with every queued event just before it is dispatched
+  static void SetRecorder(std::function<void(const QueuedEvent&)>);
 
-  static void Send(Event::Type, boost::any);
-  static void Send(Event::Type);
 private:
   EventManager() {};
 
+  // Listeners for one payload type, stored contiguously
+  template <typename T>
+    struct Channel {
+      struct Listener {
+	unsigned int id;
+	const void* owner;
+	std::function<void(const Event&, const T&)> func;
+      };
+
+      static inline std::vector<Listener> listeners;
+      static void Remove(unsigned int id);
+      static void Dispatch(const Event&, const void* payload);
+    };
+
+  static void OnRegister(Event::Type, bool duplicate);
+  static void OnUnregister(Event::Type);
+
   static double time;
-  static std::map<Event::Type,
-    std::vector<std::function<void(const Event&)> > > funcs;
+  static unsigned int nextID;
+  static size_t listenerCounts[Event::NUM_TYPES];
+
+  static bool queued;
+  static std::vector<QueuedEvent> queue;
+  static std::function<void(const QueuedEvent&)> recorder;
 };
+
+// IMPL
+template <typename T, typename F>
+EventManager::Handle EventManager::Register(F f, const void* owner)
+{
+  auto& l = Channel<T>::listeners;
+
+  bool duplicate = owner != nullptr &&
+    std::any_of(l.begin(), l.end(),
+	[owner](const typename Channel<T>::Listener& other) -> bool {
+	return other.owner == owner;
+	});
+
+  OnRegister(T::TYPE, duplicate);
+
+  Handle handle{T::TYPE, nextID++, &Channel<T>::Remove};
+  l.push_back({handle.id, owner, f});
+
+  return handle;
+}
+
+template <typename T>
+void EventManager::Send(const T& d)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+      "Event payloads must be plain values to be queued");
+  static_assert(sizeof(T) <= MAX_PAYLOAD_SIZE,
+      "Event payload too large, raise MAX_PAYLOAD_SIZE");
+
+  Event e{T::TYPE};
+  e.timestamp = time;
+
+  if (queued) {
+    queue.push_back({e, sizeof(T), &Channel<T>::Dispatch, {}});
+    std::memcpy(queue.back().payload, &d, sizeof(T));
+    return;
+  }
+
+  Channel<T>::Dispatch(e, &d);
+}
+
+template <typename T>
+void EventManager::Channel<T>::Dispatch(const Event& e, const void* payload)
+{
+  const T& d = *static_cast<const T*>(payload);
+
+  for (auto& l : listeners)
+    l.func(e, d);
+}
+
+template <typename T>
+void EventManager::Channel<T>::Remove(unsigned int id)
+{
+  auto i = std::find_if(listeners.begin(), listeners.end(),
+      [id](const Listener& l) -> bool {
+      return l.id == id;
+      });
+
+  if (i == listeners.end()) return;
+
+  listeners.erase(i);
+  OnUnregister(T::TYPE);
+}
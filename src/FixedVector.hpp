@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+// Vector with inline storage for up to N elements. Copies are a plain
+// copy of the storage, so structs holding one stay trivially copyable
+// when T is. Pushing past N is an error.
+template <typename T, size_t N>
+class FixedVector
+{
+public:
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  static constexpr size_t capacity() { return N; }
+
+  T& operator[](size_t i) { return items[i]; }
+  const T& operator[](size_t i) const { return items[i]; }
+  T& at(size_t i);
+  const T& at(size_t i) const;
+
+  iterator begin() { return items; }
+  iterator end() { return items + count; }
+  const_iterator begin() const { return items; }
+  const_iterator end() const { return items + count; }
+
+  void push_back(const T&);
+  template <typename... Args>
+    void emplace_back(Args&&...);
+  // Shifts the elements after it down by one
+  iterator erase(iterator);
+  void clear() { count = 0; }
+
+private:
+  T items[N] = {};
+  size_t count = 0;
+};
+
+// IMPL
+template <typename T, size_t N>
+T& FixedVector<T, N>::at(size_t i)
+{
+  if (i >= count) throw std::out_of_range("FixedVector::at");
+  return items[i];
+}
+
+template <typename T, size_t N>
+const T& FixedVector<T, N>::at(size_t i) const
+{
+  if (i >= count) throw std::out_of_range("FixedVector::at");
+  return items[i];
+}
+
+template <typename T, size_t N>
+void FixedVector<T, N>::push_back(const T& t)
+{
+  if (count >= N) throw std::length_error("FixedVector full");
+  items[count++] = t;
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+void FixedVector<T, N>::emplace_back(Args&&... args)
+{
+  push_back(T(std::forward<Args>(args)...));
+}
+
+template <typename T, size_t N>
+typename FixedVector<T, N>::iterator FixedVector<T, N>::erase(iterator it)
+{
+  for (iterator i = it; i + 1 < end(); ++i) *i = *(i + 1);
+  count--;
+  return it;
+}
@@ -0,0 +1,38 @@
+#include "FrameScheduler.hpp"
+
+#include <cmath>
+
+FrameScheduler::FrameScheduler(double t, int m) :
+  tickLength(t),
+  maxTicksPerFrame(m < 1 ? 1 : m),
+  accumulator(0.0)
+{
+}
+
+int FrameScheduler::advance(double frameTime)
+{
+  if (frameTime < 0.0) frameTime = 0.0;
+  accumulator += frameTime;
+
+  int ticks = std::floor(accumulator / tickLength);
+
+  if (ticks > maxTicksPerFrame) {
+    // Drop the time we can't catch up on, but keep the fractional part
+    // so alpha stays continuous
+    ticks = maxTicksPerFrame;
+    accumulator = std::fmod(accumulator, tickLength);
+  }
+  else {
+    accumulator -= ticks * tickLength;
+  }
+
+  // Guard against rounding leaving a full tick behind
+  if (accumulator >= tickLength) accumulator = 0.0;
+
+  return ticks;
+}
+
+void FrameScheduler::setMaxTicksPerFrame(int m)
+{
+  maxTicksPerFrame = m < 1 ? 1 : m;
+}
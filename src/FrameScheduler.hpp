@@ -0,0 +1,29 @@
+#pragma once
+
+// Fixed timestep scheduler.
+//
+// Accumulates real frame time and hands it out as whole logic ticks. Time
+// left over is carried to the next frame and exposed as an interpolation
+// alpha between the previous and current tick. The number of ticks per frame
+// is capped so a slow frame can't snowball into a spiral of death; time past
+// the cap is dropped and the simulation falls behind real time instead.
+class FrameScheduler
+{
+public:
+  FrameScheduler(double tickLength, int maxTicksPerFrame = 5);
+
+  // Add a frame's worth of real time, returns number of ticks to run
+  int advance(double frameTime);
+
+  double getTickLength() const { return tickLength; }
+  int getMaxTicksPerFrame() const { return maxTicksPerFrame; }
+  void setMaxTicksPerFrame(int);
+
+  // [0, 1) blend factor from the previous tick's state to the current one
+  float getAlpha() const { return accumulator / tickLength; }
+
+private:
+  double tickLength;
+  int maxTicksPerFrame;
+  double accumulator;
+};
@@ -1,24 +1,129 @@
 #include "Grenade.hpp"
-#include "Random.hpp"
+
+#include <array>
+#include <limits>
+
 #include "geo.hpp"
 #include "Console.hpp"
 
-// STATICS
-std::map<Grenade::Type, std::string> Grenade::typeStrings = {
-  {Grenade::Type::STANDARD, "Standard"},
-  {Grenade::Type::CLUSTER, "Cluster"},
-  {Grenade::Type::INERTIA, "Inertia"},
-  {Grenade::Type::TELEPORT, "Teleport"},
-  {Grenade::Type::HOMING, "Homing"},
-};
+namespace {
 
-const char* Grenade::getTypeString(Type t)
+constexpr Grenade::Properties baseProperties()
+{
+  Grenade::Properties p{};
+
+  p.name = nullptr;
+  p.lifetime = 2.0;
+
+  p.knockback = 0.f;
+  p.radius = 0.f;
+  p.terrainDamageModifier = 1.f;
+  p.terrainWobbleModifier = 1.f;
+  p.damage = 0.f;
+  p.detonateOnDeath = true;
+  p.manualDetonate = true;
+  p.detonateOnPlayerHit = false;
+  p.bounceOnPlayerHit = true;
+  p.detonateOnLand = false;
+  p.slowBeforeDetonate = false;
+  p.homing = false;
+  p.spawnInertiaZone = false;
+  p.teleportPlayerOnDetonate = false;
+  p.maxAllowedOut = std::numeric_limits<int>::max();
+  p.minClusterFragments = 0;
+  p.maxClusterFragments = 0;
+
+  return p;
+}
+
+constexpr std::array<Grenade::Properties, Grenade::NUM_TYPES> buildTable()
 {
-  const auto& i = typeStrings.find(t);
-  if (i == typeStrings.end()) {
-    return std::to_string(t).c_str();
+  using Type = Grenade::Type;
+
+  std::array<Grenade::Properties, Grenade::NUM_TYPES> table{};
+  for (auto& p : table) p = baseProperties();
+
+  {
+    auto& p = table[Type::STANDARD];
+    p.name = "Standard";
+    p.knockback = 400.f;
+    p.radius = 160.f;
+    p.damage = 50.f;
+  }
+  {
+    auto& p = table[Type::CLUSTER];
+    p.name = "Cluster";
+    p.minClusterFragments = 24;
+    p.maxClusterFragments = 30;
+    p.radius = 0.f;
+  }
+  {
+    auto& p = table[Type::CLUSTER_FRAGMENT];
+    p.name = "Cluster Fragment";
+    p.lifetime = geo::inf<double>();
+    p.radius = 50.f;
+    p.damage = 3.f;
+    p.manualDetonate = false;
+    p.detonateOnLand = true;
+    p.terrainDamageModifier = 0.2f;
+    p.terrainWobbleModifier = 0.5f;
+    p.detonateOnPlayerHit = true;
   }
-  return i->second.c_str();
+  {
+    auto& p = table[Type::INERTIA];
+    p.name = "Inertia";
+    p.radius = 120.f;
+    p.terrainDamageModifier = 0.f;
+    p.terrainWobbleModifier = 0.2f;
+    p.slowBeforeDetonate = true;
+    p.spawnInertiaZone = true;
+  }
+  {
+    auto& p = table[Type::TELEPORT];
+    p.name = "Teleport";
+    p.teleportPlayerOnDetonate = true;
+    p.lifetime = geo::inf<double>();
+    p.detonateOnDeath = false;
+    p.maxAllowedOut = 1;
+  }
+  {
+    auto& p = table[Type::HOMING];
+    p.name = "Homing";
+    p.lifetime = 5.f;
+    p.homing = true;
+    p.manualDetonate = false;
+    p.detonateOnLand = true;
+    p.detonateOnPlayerHit = true;
+    p.radius = 80.f;
+    p.damage = 10.f;
+    p.knockback = 1000.f;
+    p.detonateOnDeath = false;
+  }
+
+  ///////////////
+  // Combi
+  ///////////////
+  table[Type::COMBI_CLUSTER_INERTIA].name = "Cluster Inertia";
+
+  return table;
+}
+
+static_assert(Grenade::COMBI_CLUSTER_INERTIA < Grenade::NUM_TYPES,
+    "Grenade::NUM_TYPES doesn't cover every combination");
+
+constexpr auto propertyTable = buildTable();
+
+}
+
+const Grenade::Properties& Grenade::getProperties(Type t)
+{
+  return propertyTable[t];
+}
+
+const char* Grenade::getTypeString(Type t)
+{
+  const char* name = propertyTable[t].name;
+  return name != nullptr ? name : "Unknown";
 }
 
 /////////////////////////
@@ -34,91 +139,14 @@ Grenade::Grenade(Type t) :
   owner = -1;
   target = -1;
 
+  spawnTimestamp = 0.0;
   age = 0.f;
-  localTimescale = 1.f;
 
   position = glm::vec2();
   velocity = glm::vec2();
-  acceleration = glm::vec2();
   
-  dirty_awaitingRemoval = false;
-  dirty_justBounced = false;
   dirty_justCollidedWithPlayer = -1;
 
-  setProperties(type);
-}
-
-void Grenade::setProperties(Grenade::Type type)
-{
-  // Base properties
-  properties.lifetime = 2.0;
-
-  properties.knockback = 0.f;
-  properties.radius = 0.f;
-  properties.terrainDamageModifier = 1.f;
-  properties.terrainWobbleModifier = 1.f;
-  properties.damage = 0.f;
-  properties.numClusterFragments = 0;
-  properties.detonateOnDeath = true;
-  properties.manualDetonate = true;
-  properties.detonateOnPlayerHit = false;
-  properties.bounceOnPlayerHit = true;
-  properties.detonateOnLand = false;
-  properties.slowBeforeDetonate = false;
-  properties.homing = false;
-  properties.spawnInertiaZone = false;
-  properties.teleportPlayerOnDetonate = false;
-  properties.maxAllowedOut = geo::inf<float>();
-
-  switch(type) {
-    case Type::STANDARD:
-      properties.knockback = 400.f;
-      properties.radius = 160.f;
-      properties.damage = 50.f;
-      break;
-    case Type::CLUSTER:
-      properties.numClusterFragments = Random::randomInt(24, 30);
-      properties.radius = 0.f;
-      break;
-    case Type::CLUSTER_FRAGMENT:
-      properties.lifetime = geo::inf<double>();
-      properties.radius = 50.f;
-      properties.damage = 3.f;
-      properties.manualDetonate = false;
-      properties.detonateOnLand = true;
-      properties.terrainDamageModifier = 0.2f;
-      properties.terrainWobbleModifier = 0.5f;
-      properties.detonateOnPlayerHit = true;
-      dirty_justBounced = true;
-      break;
-    case Type::INERTIA:
-      properties.radius = 120.f;
-      properties.terrainDamageModifier = 0.f;
-      properties.terrainWobbleModifier = 0.2f;
-      properties.slowBeforeDetonate = true;
-      properties.spawnInertiaZone = true;
-      break;
-    case Type::TELEPORT:
-      properties.teleportPlayerOnDetonate = true;
-      properties.lifetime = geo::inf<double>();
-      properties.detonateOnDeath = false;
-      properties.maxAllowedOut = 1;
-      break;
-    case Type::HOMING:
-      properties.lifetime = 5.f;
-      properties.homing = true;
-      properties.manualDetonate = false;
-      properties.detonateOnLand = true;
-      properties.detonateOnPlayerHit = true;
-      properties.radius = 80.f;
-      properties.damage = 10.f;
-      properties.knockback = 1000.f;
-      properties.detonateOnDeath = false;
-      break;
-
-    ///////////////
-    // Combi
-    ///////////////
-    default: break;
-  }
+  // Fragments skip their first terrain test
+  dirty_justBounced = type == Type::CLUSTER_FRAGMENT;
 }
@@ -1,13 +1,21 @@
 #pragma once
 
 #include <glm/vec2.hpp>
-#include <map>
-#include <string>
 #include "geo.hpp"
 
+// Refers to a grenade in a GrenadePool. Checked against the slot's
+// generation, so it stops resolving once the grenade is removed.
+struct GrenadeHandle
+{
+  unsigned int slot;
+  unsigned int generation;
+};
+
+// A grenade's full state as a plain value. Live grenades are kept split
+// into arrays by GrenadePool, this is used to spawn them.
 struct Grenade
 {
-  // Don't forget to add typename string in .cpp file!!
+  // Don't forget to fill in its properties in the .cpp file!!
   enum Type {
     // Player ownable
     STANDARD,
@@ -25,34 +33,16 @@ struct Grenade
     COMBI_CLUSTER_INERTIA = _2 + geo::uniquePair(CLUSTER, INERTIA),
   };
 
-  static std::map<Type, std::string> typeStrings;
-  static const char* getTypeString(Type);
-
-  static constexpr double SUB_LIFETIME_DELAY = 0.5;
+  // Type of the grenade combining two player ownable types
+  static constexpr Type combine(Type a, Type b) {
+    return Type(_2 + geo::uniquePair(a, b));
+  }
+  // Room for every type, up to the combination of the last two ownable
+  static constexpr int NUM_TYPES = _2 + geo::uniquePair(_1 - 2, _1 - 1) + 1;
 
-  Grenade();
-  Grenade(Type);
-  void setProperties(Grenade::Type);
-
-  Type type;
-  int owner;
-  int target;
-  double spawnTimestamp;
-  double age;
-  double localTimescale;
-
-  glm::vec2 position;
-  glm::vec2 velocity;
-  glm::vec2 acceleration;
-
-  bool subDetonated;
-
-  bool dirty_justBounced;
-  bool dirty_awaitingRemoval;
-  int dirty_justCollidedWithPlayer;
-
-  // Properties
-  struct {
+  // Behaviour shared by every grenade of a type
+  struct Properties {
+    const char* name;
 
     double lifetime;
 
@@ -69,12 +59,33 @@ struct Grenade
     bool bounceOnPlayerHit;
     bool slowBeforeDetonate;
     bool homing;
-    int numClusterFragments;
     bool spawnInertiaZone;
     bool teleportPlayerOnDetonate;
     int maxAllowedOut;
 
-  } properties;
+    // Rolled each time one explodes
+    int minClusterFragments;
+    int maxClusterFragments;
+  };
+
+  static const Properties& getProperties(Type);
+  static const char* getTypeString(Type);
+
+  static constexpr double SUB_LIFETIME_DELAY = 0.5;
+
+  Grenade();
+  Grenade(Type);
+
+  Type type;
+  int owner;
+  int target;
+  double spawnTimestamp;
+  double age;
 
+  glm::vec2 position;
+  glm::vec2 velocity;
+
+  bool dirty_justBounced;
+  int dirty_justCollidedWithPlayer;
 };
 
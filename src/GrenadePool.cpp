@@ -0,0 +1,124 @@
+#include "GrenadePool.hpp"
+
+#include "Serialize.hpp"
+
+GrenadeHandle GrenadePool::add(const Grenade& g)
+{
+  unsigned int slot;
+  if (freeSlots.empty()) {
+    slot = slots.size();
+    slots.push_back({0, 0});
+  }
+  else {
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+  }
+
+  slots[slot].index = size();
+  slotOf.push_back(slot);
+
+  position.push_back(g.position);
+  velocity.push_back(g.velocity);
+  age.push_back(g.age);
+  previousPosition.push_back(g.position);
+
+  flags.push_back(g.dirty_justBounced ? JUST_BOUNCED : 0);
+  justCollidedWithPlayer.push_back(g.dirty_justCollidedWithPlayer);
+
+  type.push_back(g.type);
+  owner.push_back(g.owner);
+  target.push_back(g.target);
+  spawnTimestamp.push_back(g.spawnTimestamp);
+
+  return {slot, slots[slot].generation};
+}
+
+namespace {
+
+template <typename T>
+void swapAndPop(std::vector<T>& v, size_t i)
+{
+  v[i] = v.back();
+  v.pop_back();
+}
+
+}
+
+void GrenadePool::remove(size_t i)
+{
+  // Invalidate handles to the removed grenade
+  unsigned int slot = slotOf[i];
+  slots[slot].generation++;
+  freeSlots.push_back(slot);
+
+  // The last grenade moves into i
+  slots[slotOf.back()].index = i;
+
+  swapAndPop(slotOf, i);
+  swapAndPop(position, i);
+  swapAndPop(velocity, i);
+  swapAndPop(age, i);
+  swapAndPop(previousPosition, i);
+  swapAndPop(flags, i);
+  swapAndPop(justCollidedWithPlayer, i);
+  swapAndPop(type, i);
+  swapAndPop(owner, i);
+  swapAndPop(target, i);
+  swapAndPop(spawnTimestamp, i);
+}
+
+GrenadeHandle GrenadePool::getHandle(size_t i) const
+{
+  unsigned int slot = slotOf[i];
+  return {slot, slots[slot].generation};
+}
+
+int GrenadePool::find(GrenadeHandle h) const
+{
+  if (h.slot >= slots.size()) return -1;
+  if (slots[h.slot].generation != h.generation) return -1;
+
+  return slots[h.slot].index;
+}
+
+void GrenadePool::setFlag(size_t i, Flag f, bool on)
+{
+  if (on) flags[i] |= f;
+  else flags[i] &= ~f;
+}
+
+void GrenadePool::write(std::ostream& out) const
+{
+  using namespace serialize;
+  writeVector(out, position);
+  writeVector(out, velocity);
+  writeVector(out, age);
+  writeVector(out, previousPosition);
+  writeVector(out, flags);
+  writeVector(out, justCollidedWithPlayer);
+  writeVector(out, type);
+  writeVector(out, owner);
+  writeVector(out, target);
+  writeVector(out, spawnTimestamp);
+  writeVector(out, slotOf);
+  writeVector(out, slots);
+  writeVector(out, freeSlots);
+}
+
+bool GrenadePool::read(std::istream& in)
+{
+  using namespace serialize;
+  return readVector(in, position) &&
+    readVector(in, velocity) &&
+    readVector(in, age) &&
+    readVector(in, previousPosition) &&
+    readVector(in, flags) &&
+    readVector(in, justCollidedWithPlayer) &&
+    readVector(in, type) &&
+    readVector(in, owner) &&
+    readVector(in, target) &&
+    readVector(in, spawnTimestamp) &&
+    readVector(in, slotOf) &&
+    readVector(in, slots) &&
+    readVector(in, freeSlots);
+}
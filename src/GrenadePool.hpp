@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <iosfwd>
+#include <glm/vec2.hpp>
+
+#include "Grenade.hpp"
+
+// Live grenades, stored as parallel arrays so passes over them only pull
+// in the fields they use. Removal moves the last grenade into the gap, so
+// indices change; hold a GrenadeHandle to refer to one grenade over time.
+struct GrenadePool
+{
+  enum Flag : uint8_t {
+    JUST_BOUNCED = 1 << 0,
+    AWAITING_REMOVAL = 1 << 1,
+  };
+
+  // Hot: integrated every tick
+  std::vector<glm::vec2> position;
+  std::vector<glm::vec2> velocity;
+  std::vector<double> age;
+  // Position at the start of the current tick, for render interpolation
+  std::vector<glm::vec2> previousPosition;
+
+  std::vector<uint8_t> flags;
+  std::vector<int> justCollidedWithPlayer;
+
+  // Cold: read on spawn, explosion and targeting.
+  // Properties come from Grenade::getProperties(type).
+  std::vector<Grenade::Type> type;
+  std::vector<int> owner;
+  std::vector<int> target;
+  std::vector<double> spawnTimestamp;
+
+  size_t size() const { return position.size(); }
+
+  GrenadeHandle add(const Grenade&);
+  // Swap the last grenade into i, then shrink by one
+  void remove(size_t i);
+
+  GrenadeHandle getHandle(size_t i) const;
+  // Current index of the grenade, or -1 if it has been removed
+  int find(GrenadeHandle) const;
+
+  bool hasFlag(size_t i, Flag f) const { return flags[i] & f; }
+  void setFlag(size_t i, Flag f, bool on);
+
+  // Every array including the handle slots, see Serialize.hpp
+  void write(std::ostream&) const;
+  bool read(std::istream&);
+
+private:
+  struct Slot {
+    unsigned int index;
+    unsigned int generation;
+  };
+
+  // Which slot each grenade belongs to, parallel to the arrays above
+  std::vector<unsigned int> slotOf;
+  std::vector<Slot> slots;
+  std::vector<unsigned int> freeSlots;
+};
@@ -14,278 +14,364 @@
 #include "PlayerSystem.hpp"
 #include "Random.hpp"
 
+#include <algorithm>
+
 GrenadeSystem::GrenadeSystem(
     const Terrain& t,
     const TimescaleSystem& ts,
     const PlayerSystem& p) :
+  random(Random::stream(Random::GRENADES)),
   terrain(t),
   timescaleSystem(ts),
   playerSystem(p)
 {
-  EventManager::Register(Event::PLAYER_THROW_GRENADE,
-      std::bind(&GrenadeSystem::onPlayerThrowGrenade, this, _1));
+  eventHandles.push_back(EventManager::Register<EvdPlayerThrowGrenade>(
+      std::bind(&GrenadeSystem::onPlayerThrowGrenade, this, _1, _2), this));
 
-  EventManager::Register(Event::PLAYER_DETONATE_GRENADE,
-      std::bind(&GrenadeSystem::onPlayerDetonateGrenade, this, _1));
+  eventHandles.push_back(EventManager::Register<EvdPlayerDetonateGrenade>(
+      std::bind(&GrenadeSystem::onPlayerDetonateGrenade, this, _1, _2), this));
 }
 
-void GrenadeSystem::update(double gdt)
+GrenadeSystem::~GrenadeSystem()
 {
-  // Remove dead grenades
-  grenades.erase(std::remove_if(grenades.begin(), grenades.end(),
-	[](const Grenade& g)->bool {
-	return g.dirty_awaitingRemoval;
-	}), grenades.end());
-  
-  // Add new grenades
-  grenades.insert(grenades.end(),
-      grenadesToSpawn.begin(), grenadesToSpawn.end());
-  grenadesToSpawn.clear();
-
-  for (auto& g : grenades) {
-    double newTimescale = timescaleSystem.getTimescaleAtPosition(g.position);
-    double dt = newTimescale * gdt;
-
-    g.age += dt;
-
-    // ------------
-    // Physics
-    // ------------
-
-    // Gravity
-    g.acceleration = glm::vec2(0.f, -1000.f);
-
-    //// Homing behaviour
-
-    // 1) Assign target
-    if (g.target == -1 && g.properties.homing && g.age > 0.5f && g.velocity.y <= 10) {
-      float closestPlayerSqDist = geo::inf<float>();
-      for (const auto& p : playerSystem.getPlayers()) {
-	// Don't track player who threw the grenade
-	if (p.id == g.owner) continue;
-	// Don't track dead players
-	if (!p.alive) continue;
-
-	float currentPlayerSqDist = geo::sqdist(g.position, p.position);
-	// Don't track players too far away
-	if (currentPlayerSqDist > geo::sq(800.f)) continue;
-
-	if (currentPlayerSqDist < closestPlayerSqDist) {
-	  closestPlayerSqDist = currentPlayerSqDist;
-	  g.target = p.id;
-	}
-      }
-    }
+  for (auto h : eventHandles)
+    EventManager::Unregister(h);
+}
 
-    if (g.properties.homing && g.target != -1) {
-      // Remove acceleration from gravity
-      g.acceleration = glm::vec2();
+void GrenadeSystem::saveState(State& s) const
+{
+  s.grenades = grenades;
+  s.randomCounter = random.getCounter();
+}
 
-      // Tend to full speed
-      float oldSpeed = glm::length(g.velocity);
-      float targetSpeed = 1500.f;
-      float newSpeed = oldSpeed + 1.4 * dt * (targetSpeed - oldSpeed);
+void GrenadeSystem::restoreState(const State& s)
+{
+  grenades = s.grenades;
+  random.setCounter(s.randomCounter);
+}
 
-      if (g.target >= 0) {
-	const auto& p = playerSystem.getPlayer(g.target);
-	glm::vec2 targetPosition = p.getCenterPosition();
+namespace {
 
-	// Correct direction
-	glm::vec2 targetDirection = glm::normalize(targetPosition - g.position);
-	glm::vec2 currentDirection = glm::normalize(g.velocity);
+// Gravity and position step over contiguous arrays. Each grenade's step is
+// its scaled dt; gravity is zero for grenades homing in on a target.
+// Branch-free so the compiler can vectorize it.
+void integrateKernel(const glm::vec2* __restrict positions,
+    glm::vec2* __restrict velocities, const float* __restrict steps,
+    const float* __restrict gravity, glm::vec2* __restrict newPositions,
+    size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    velocities[i].y += gravity[i] * steps[i];
+    newPositions[i] = positions[i] + velocities[i] * steps[i];
+  }
+}
 
-	float rotateAmount = 12.f * dt;
+}
 
-	float angle =
-	  glm::abs(glm::acos(glm::dot(targetDirection, currentDirection)));
+void GrenadeSystem::update(double gdt)
+{
+  // Remove dead grenades. Walk backwards so each grenade swapped into a
+  // gap has already been checked.
+  for (size_t i = grenades.size(); i-- > 0; ) {
+    if (grenades.hasFlag(i, GrenadePool::AWAITING_REMOVAL))
+      grenades.remove(i);
+  }
 
-	if (angle < rotateAmount) {
-	  g.velocity = newSpeed * targetDirection;
-	}
-	else {
-	  float dir = geo::ccw(glm::vec2(), targetDirection, currentDirection) ?
-	    -1 : 1;
-	  if (glm::sign(g.velocity.x) != glm::sign(targetDirection.x) &&
-	      glm::abs(g.position.x - targetPosition.x) > 200.f) {
-	    dir = -glm::sign(targetDirection.x);
-	  }
-	  g.velocity = newSpeed * glm::normalize(
-	      glm::rotate(g.velocity, rotateAmount*dir));
-	}
+  for (size_t i = 0; i < grenades.size(); ++i) {
+    grenades.previousPosition[i] = grenades.position[i];
+  }
 
-	// Stop tracking player once within range, or out of range
-	float sqDist = geo::sqdist(g.position, targetPosition);
-	if (sqDist < geo::sq(100.f)) {
-	  g.target = -2;
-	}
-      }
-      else {
-	g.velocity = newSpeed * glm::normalize(g.velocity);
-      }
-    }
+  // Grenades spawned during the passes below are appended past n, and
+  // start moving next tick
+  size_t n = grenades.size();
+  steps.resize(n);
+  timescales.resize(n);
+  gravity.resize(n);
+  newPositions.resize(n);
+
+  // Local time
+  if (n > 0)
+    timescaleSystem.getTimescales(&grenades.position[0], &timescales[0], n);
+
+  for (size_t i = 0; i < n; ++i) {
+    double dt = timescales[i] * gdt;
+    grenades.age[i] += dt;
+    steps[i] = dt;
+  }
 
-    // Slow before detonate
-    float slowFactor = 1.0;
-    if (g.properties.slowBeforeDetonate &&
-	g.properties.lifetime - g.age < 0.5) {
-      slowFactor = glm::pow(2*(g.properties.lifetime - g.age), 2);
+  // Homing, steers velocity directly
+  for (size_t i = 0; i < n; ++i) {
+    if (Grenade::getProperties(grenades.type[i]).homing)
+      updateHoming(i, steps[i]);
+  }
+
+  // Gravity, and slow before detonate
+  for (size_t i = 0; i < n; ++i) {
+    const auto& properties = Grenade::getProperties(grenades.type[i]);
+
+    // Homing grenades ignore gravity once they've picked a target
+    gravity[i] = properties.homing && grenades.target[i] != -1 ? 0.f : -1000.f;
+
+    if (properties.slowBeforeDetonate &&
+	properties.lifetime - grenades.age[i] < 0.5) {
+      float slowFactor = glm::pow(2*(properties.lifetime - grenades.age[i]), 2);
       if (slowFactor < 0.05) slowFactor = 0.05;
+      steps[i] *= slowFactor;
     }
+  }
+
+  integrateKernel(grenades.position.data(), grenades.velocity.data(),
+      steps.data(), gravity.data(), newPositions.data(), n);
 
-    g.velocity += g.acceleration * (float)dt * slowFactor;
-    glm::vec2 newPosition = g.position + g.velocity * (float)dt * slowFactor;
+  // Collisions. Index rather than hold references, spawning can
+  // reallocate the arrays.
+  for (size_t i = 0; i < n; ++i) {
+    // Lives in the static table, safe to hold while the pool grows
+    const auto& properties = Grenade::getProperties(grenades.type[i]);
+    glm::vec2 newPosition = newPositions[i];
 
     // Bounce on terrain
     // ------------------
-    if (g.dirty_justBounced) {
-      g.dirty_justBounced = false;
-    }
-    else {
-      std::vector<LineSegment> tSegments =
-	terrain.getSegmentsInRange(g.position.x, newPosition.x);
+    bool aboveTerrain =
+      glm::min(grenades.position[i].y, newPosition.y) > terrain.getMaxHeight();
 
-      bool foundIntersection = false;
-      for (auto& s : tSegments) {
-
-	auto intersection =
-	  geo::intersect(s.first, s.second, g.position, newPosition);
+    if (grenades.hasFlag(i, GrenadePool::JUST_BOUNCED)) {
+      grenades.setFlag(i, GrenadePool::JUST_BOUNCED, false);
+    }
+    else if (!aboveTerrain) {
+      auto intersection = terrain.intersect(grenades.position[i], newPosition);
 
-	if (intersection.first) {
-	  foundIntersection = true;
-	  g.dirty_justBounced = true;
-	  g.dirty_justCollidedWithPlayer = -1;
+      if (intersection.first) {
+	grenades.setFlag(i, GrenadePool::JUST_BOUNCED, true);
+	grenades.justCollidedWithPlayer[i] = -1;
 
-	  newPosition = intersection.second;
-	  grenadeHitGround(g, newPosition);
-	  break;
-	}
+	newPosition = intersection.second;
+	grenadeHitGround(i, newPosition);
       }
       // Failsafe
-      if (!foundIntersection &&
-	  newPosition.y < terrain.getHeight(newPosition.x)) {
+      else if (newPosition.y < terrain.getHeight(newPosition.x)) {
 	newPosition.y = terrain.getHeight(newPosition.x);
-	grenadeHitGround(g, newPosition);
+	grenadeHitGround(i, newPosition);
       }
     }
 
     // Collide with players
     // --------------------
-    for (const auto& p : playerSystem.getPlayers()) {
+    glm::vec2 position = grenades.position[i];
+    playerSystem.queryPlayers(glm::min(position, newPosition),
+	glm::max(position, newPosition), nearbyPlayers);
+
+    // Can't still be inside a player the broadphase didn't find
+    int& justCollided = grenades.justCollidedWithPlayer[i];
+    if (justCollided >= 0 &&
+	!std::binary_search(nearbyPlayers.begin(), nearbyPlayers.end(),
+	  justCollided)) {
+      justCollided = -1;
+    }
+
+    for (int id : nearbyPlayers) {
+      const auto& p = playerSystem.getPlayer(id);
       if (p.ghost) continue;
 
       // Avoid getting stuck inside players
-      if (g.dirty_justCollidedWithPlayer == p.id) {
-	if (p.collidesWith(g.position, newPosition)) continue;
-	else g.dirty_justCollidedWithPlayer = -1;
+      if (grenades.justCollidedWithPlayer[i] == p.id) {
+	if (p.collidesWith(position, newPosition)) continue;
+	else grenades.justCollidedWithPlayer[i] = -1;
       }
 
-      if (p.collidesWith(g.position, newPosition)) {
-	if (g.properties.detonateOnPlayerHit) {
-	  explodeGrenade(g);
+      if (p.collidesWith(position, newPosition)) {
+	if (properties.detonateOnPlayerHit) {
+	  explodeGrenade(i);
 	  break;
 	}
 
-	if (g.properties.bounceOnPlayerHit) {
-	  glm::vec2 bounceDirection = glm::normalize(g.position - p.position);
-	  g.velocity =
-	    0.6f * glm::length(g.velocity) * bounceDirection +
+	if (properties.bounceOnPlayerHit) {
+	  glm::vec2 bounceDirection = glm::normalize(position - p.position);
+	  grenades.velocity[i] =
+	    0.6f * glm::length(grenades.velocity[i]) * bounceDirection +
 	    0.2f * p.velocity;
-	  g.dirty_justCollidedWithPlayer = p.id;
+	  grenades.justCollidedWithPlayer[i] = p.id;
 	  break;
 	}
       }
     }
 
-    g.position = newPosition;
+    grenades.position[i] = newPosition;
+
+    if (grenades.age[i] >= properties.lifetime) {
+      properties.detonateOnDeath ?
+	explodeGrenade(i) : fizzleGrenade(i);
+    }
+
+  }
+}
+
+void GrenadeSystem::updateHoming(size_t i, float dt)
+{
+  glm::vec2 position = grenades.position[i];
+  glm::vec2& velocity = grenades.velocity[i];
+  int& target = grenades.target[i];
+
+  // 1) Assign target
+  if (target == -1 && grenades.age[i] > 0.5f && velocity.y <= 10) {
+    float closestPlayerSqDist = geo::inf<float>();
+    playerSystem.queryPlayers(position - glm::vec2(800.f),
+	position + glm::vec2(800.f), nearbyPlayers);
+
+    for (int id : nearbyPlayers) {
+      const auto& p = playerSystem.getPlayer(id);
+      // Don't track player who threw the grenade
+      if (p.id == grenades.owner[i]) continue;
+      // Don't track dead players
+      if (!p.alive) continue;
+
+      float currentPlayerSqDist = geo::sqdist(position, p.position);
+      // Don't track players too far away
+      if (currentPlayerSqDist > geo::sq(800.f)) continue;
+
+      if (currentPlayerSqDist < closestPlayerSqDist) {
+	closestPlayerSqDist = currentPlayerSqDist;
+	target = p.id;
+      }
+    }
+  }
+
+  if (target == -1) return;
+
+  // Tend to full speed
+  float oldSpeed = glm::length(velocity);
+  float targetSpeed = 1500.f;
+  float newSpeed = oldSpeed + 1.4 * dt * (targetSpeed - oldSpeed);
+
+  if (target >= 0) {
+    const auto& p = playerSystem.getPlayer(target);
+    glm::vec2 targetPosition = p.getCenterPosition();
+
+    // Correct direction
+    glm::vec2 targetDirection = glm::normalize(targetPosition - position);
+    glm::vec2 currentDirection = glm::normalize(velocity);
 
-    if (g.age >= g.properties.lifetime) {
-      g.properties.detonateOnDeath ?
-	explodeGrenade(g) : fizzleGrenade(g);
+    float rotateAmount = 12.f * dt;
+
+    float angle =
+      glm::abs(glm::acos(glm::dot(targetDirection, currentDirection)));
+
+    if (angle < rotateAmount) {
+      velocity = newSpeed * targetDirection;
+    }
+    else {
+      float dir = geo::ccw(glm::vec2(), targetDirection, currentDirection) ?
+	-1 : 1;
+      if (glm::sign(velocity.x) != glm::sign(targetDirection.x) &&
+	  glm::abs(position.x - targetPosition.x) > 200.f) {
+	dir = -glm::sign(targetDirection.x);
+      }
+      velocity = newSpeed * glm::normalize(
+	  glm::rotate(velocity, rotateAmount*dir));
     }
 
+    // Stop tracking player once within range, or out of range
+    float sqDist = geo::sqdist(position, targetPosition);
+    if (sqDist < geo::sq(100.f)) {
+      target = -2;
+    }
+  }
+  else {
+    velocity = newSpeed * glm::normalize(velocity);
   }
 }
 
-void GrenadeSystem::grenadeHitGround(Grenade& g, glm::vec2)
+void GrenadeSystem::grenadeHitGround(size_t i, glm::vec2)
 {
-  if (g.properties.detonateOnLand) {
-    explodeGrenade(g);
+  if (Grenade::getProperties(grenades.type[i]).detonateOnLand) {
+    explodeGrenade(i);
     return;
   }
 
-  float terrainAngle = terrain.getAngle(g.position.x);
-  float grenadeAngle = glm::atan(g.velocity.y, g.velocity.x);
+  glm::vec2& velocity = grenades.velocity[i];
+
+  float terrainAngle = terrain.getAngle(grenades.position[i].x);
+  float grenadeAngle = glm::atan(velocity.y, velocity.x);
   float rotateAngle = 2 * (terrainAngle - grenadeAngle);
-  g.velocity = 0.5f * glm::rotate(g.velocity, rotateAngle);
+  velocity = 0.5f * glm::rotate(velocity, rotateAngle);
   // g.position = pos;
 }
 
-void GrenadeSystem::explodeGrenade(Grenade& g)
+void GrenadeSystem::explodeGrenade(size_t i)
 {
-  g.dirty_awaitingRemoval = true;
+  grenades.setFlag(i, GrenadePool::AWAITING_REMOVAL, true);
 
   EvdGrenadeExplosion d;
-  d.grenade = &g;
-  EventManager::Send(Event::EXPLOSION, d);
-
-  // Spawn cluster fragments
-  for (int i = 0; i < g.properties.numClusterFragments; ++i) {
-    Grenade& f = spawnGrenade(Grenade::Type::CLUSTER_FRAGMENT);
-    f.owner = g.owner;
-    f.position = g.position;
-    f.velocity.x = 0.3f*g.velocity.x + 230.f*Random::randomFloat(-1.f, 1.f);
-    f.velocity.y = 400.f*Random::randomFloat(0.5f, 1.f);
+  d.grenade = grenades.getHandle(i);
+  d.type = grenades.type[i];
+  d.owner = grenades.owner[i];
+  d.position = grenades.position[i];
+  EventManager::Send(d);
+
+  const auto& properties = Grenade::getProperties(d.type);
+  if (properties.maxClusterFragments == 0) return;
+
+  // Spawn cluster fragments. Copy what they need first, spawning can
+  // reallocate the arrays.
+  int owner = grenades.owner[i];
+  glm::vec2 position = grenades.position[i];
+  glm::vec2 velocity = grenades.velocity[i];
+
+  int numFragments = random.randomInt(
+      properties.minClusterFragments, properties.maxClusterFragments);
+
+  for (int f = 0; f < numFragments; ++f) {
+    Grenade fragment(Grenade::Type::CLUSTER_FRAGMENT);
+    fragment.owner = owner;
+    fragment.position = position;
+    fragment.velocity.x = 0.3f*velocity.x + 230.f*random.randomFloat(-1.f, 1.f);
+    fragment.velocity.y = 400.f*random.randomFloat(0.5f, 1.f);
+    spawnGrenade(fragment);
   }
 }
 
-void GrenadeSystem::fizzleGrenade(Grenade& g)
+void GrenadeSystem::fizzleGrenade(size_t i)
 {
-  g.dirty_awaitingRemoval = true;
+  grenades.setFlag(i, GrenadePool::AWAITING_REMOVAL, true);
   return;
 }
 
-void GrenadeSystem::onPlayerThrowGrenade(const Event& e)
+void GrenadeSystem::onPlayerThrowGrenade(const Event& e, const EvdPlayerThrowGrenade& d)
 {
-  auto d = boost::any_cast<EvdPlayerThrowGrenade>(e.data);
-  const Player* p = d.player;
-
-  Grenade::Type type = p->inventory[p->primaryGrenadeSlot].type;
-
-  Grenade& g = spawnGrenade(type);
-  g.owner = p->id;
+  Grenade g(d.grenadeType);
+  g.owner = d.playerID;
   g.spawnTimestamp = e.timestamp;
   g.dirty_justCollidedWithPlayer = g.owner;
 
   float strength = 600.f;
-  g.position = p->getCenterPosition();
-  g.velocity = 0.33f * p->velocity;
-  g.velocity.x += strength * glm::cos(p->aimDirection);
-  g.velocity.y += strength * -glm::sin(p->aimDirection);
+  g.position = d.position;
+  g.velocity = 0.33f * d.velocity;
+  g.velocity.x += strength * glm::cos(d.aimDirection);
+  g.velocity.y += strength * -glm::sin(d.aimDirection);
+
+  spawnGrenade(g);
 }
 
-void GrenadeSystem::onPlayerDetonateGrenade(const Event& e)
+void GrenadeSystem::onPlayerDetonateGrenade(const Event&, const EvdPlayerDetonateGrenade& d)
 {
-  const auto* p = boost::any_cast<EvdPlayerDetonateGrenade>(e.data).player;
-
-  Grenade* oldestGrenade = nullptr;
-  for (auto& g : grenades) {
+  int oldestGrenade = -1;
+  for (size_t i = 0; i < grenades.size(); ++i) {
     // Grenade secondary fire explodes grenades
-    if (g.owner == p->id &&
-	g.properties.manualDetonate &&
-	(oldestGrenade == nullptr ||
-	 g.spawnTimestamp < oldestGrenade->spawnTimestamp)) {
+    if (grenades.owner[i] == d.playerID &&
+	Grenade::getProperties(grenades.type[i]).manualDetonate &&
+	(oldestGrenade == -1 ||
+	 grenades.spawnTimestamp[i] < grenades.spawnTimestamp[oldestGrenade])) {
 
-      oldestGrenade = &g;
+      oldestGrenade = i;
     }
   }
 
-  if (oldestGrenade != nullptr) {
-      explodeGrenade(*oldestGrenade);
+  if (oldestGrenade != -1) {
+      explodeGrenade(oldestGrenade);
   }
 }
 
-Grenade& GrenadeSystem::spawnGrenade(Grenade::Type type)
+GrenadeHandle GrenadeSystem::spawnGrenade(const Grenade& g)
 {
-  grenadesToSpawn.emplace_back(Grenade(type));
-  return grenadesToSpawn.back();
+  return grenades.add(g);
 }
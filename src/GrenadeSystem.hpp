@@ -3,6 +3,9 @@
 #include <vector>
 
 #include "Grenade.hpp"
+#include "GrenadePool.hpp"
+#include "EventManager.hpp"
+#include "Random.hpp"
 
 struct Event;
 class Terrain;
@@ -16,23 +19,48 @@ public:
       const TimescaleSystem&,
       const PlayerSystem&
       );
+  ~GrenadeSystem();
+
+  struct State {
+    GrenadePool grenades;
+    uint64_t randomCounter;
+  };
+
+  // Copies into s, reusing its storage
+  void saveState(State& s) const;
+  void restoreState(const State&);
 
   void update(double dt);
-  const std::vector<Grenade>& getGrenades() const { return grenades; }
+  const GrenadePool& getGrenades() const { return grenades; }
+
+  // Starts moving next update
+  GrenadeHandle spawnGrenade(const Grenade&);
 
 private:
 
-  void onPlayerThrowGrenade(const Event&);
-  void onPlayerDetonateGrenade(const Event&);
+  void onPlayerThrowGrenade(const Event&, const EvdPlayerThrowGrenade&);
+  void onPlayerDetonateGrenade(const Event&, const EvdPlayerDetonateGrenade&);
+  std::vector<EventManager::Handle> eventHandles;
+
+  // Take the grenade's current index in the pool
+  void grenadeHitGround(size_t, glm::vec2);
+  void explodeGrenade(size_t);
+  void fizzleGrenade(size_t);
+  void updateHoming(size_t, float dt);
+
+  GrenadePool grenades;
 
-  void grenadeHitGround(Grenade&, glm::vec2);
-  void explodeGrenade(Grenade&);
-  void fizzleGrenade(Grenade&);
+  // Per-update scratch, parallel to the pool
+  std::vector<float> steps;
+  std::vector<double> timescales;
+  std::vector<float> gravity;
+  std::vector<glm::vec2> newPositions;
 
-  Grenade& spawnGrenade(Grenade::Type t = Grenade::Type::STANDARD);
+  // Scratch space for player broadphase queries
+  std::vector<int> nearbyPlayers;
 
-  std::vector<Grenade> grenades;
-  std::vector<Grenade> grenadesToSpawn;
+  // Cluster fragment scatter
+  RandomStream random;
 
   const Terrain& terrain;
   const TimescaleSystem& timescaleSystem;
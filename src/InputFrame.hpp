@@ -0,0 +1,22 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+// Controller input that changed since the previous tick: button presses
+// and releases in the order they happened, and new axis values for each
+// controller whose axes moved.
+struct InputFrame
+{
+  struct Button {
+    int controllerID;
+    int button;
+    bool action;
+  };
+
+  std::vector<Button> buttons;
+  std::map<int, std::vector<float>> axes;
+
+  bool empty() const { return buttons.empty() && axes.empty(); }
+  void clear() { buttons.clear(); axes.clear(); }
+};
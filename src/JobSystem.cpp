@@ -0,0 +1,137 @@
+#include "JobSystem.hpp"
+
+// Statics
+std::vector<std::thread> JobSystem::workers;
+std::vector<std::unique_ptr<JobSystem::Queue>> JobSystem::queues;
+std::mutex JobSystem::wakeMutex;
+std::condition_variable JobSystem::wake;
+std::atomic<bool> JobSystem::running(false);
+std::atomic<unsigned int> JobSystem::pending(0);
+std::atomic<unsigned int> JobSystem::nextQueue(0);
+thread_local unsigned int JobSystem::threadQueue = 0;
+
+void JobSystem::Init(unsigned int numWorkers)
+{
+  Shutdown();
+  if (numWorkers == 0) return;
+
+  // Queue 0 belongs to threads outside the pool
+  for (unsigned int i = 0; i < numWorkers + 1; ++i)
+    queues.emplace_back(new Queue());
+
+  running = true;
+  for (unsigned int i = 0; i < numWorkers; ++i)
+    workers.emplace_back(&JobSystem::WorkerLoop, i + 1);
+}
+
+void JobSystem::Shutdown()
+{
+  if (!running) return;
+
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    running = false;
+  }
+  wake.notify_all();
+
+  for (auto& w : workers)
+    w.join();
+
+  workers.clear();
+  queues.clear();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain,
+    const std::function<void(size_t, size_t)>& f)
+{
+  if (count == 0) return;
+  if (grain == 0) grain = 1;
+
+  if (workers.empty() || count <= grain) {
+    f(0, count);
+    return;
+  }
+
+  size_t numChunks = (count + grain - 1) / grain;
+  std::atomic<size_t> remaining(numChunks);
+
+  // Keep the first chunk for this thread, spread the rest over the queues
+  for (size_t c = 1; c < numChunks; ++c) {
+    size_t begin = c * grain;
+    size_t end = begin + grain < count ? begin + grain : count;
+
+    // Counted before it's visible, so a thief can't take it first
+    pending++;
+
+    unsigned int q = nextQueue++ % queues.size();
+    std::lock_guard<std::mutex> lock(queues[q]->mutex);
+    queues[q]->jobs.push_back({[&f, begin, end]() { f(begin, end); },
+	&remaining});
+  }
+
+  // Sleeping workers check pending under wakeMutex, taking it here means
+  // none can miss the notify between checking and waiting
+  { std::lock_guard<std::mutex> lock(wakeMutex); }
+  wake.notify_all();
+
+  f(0, grain);
+  remaining--;
+
+  // Help out until every chunk is done
+  while (remaining > 0) {
+    if (!RunOne(threadQueue))
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+  threadQueue = index;
+
+  while (running) {
+    if (RunOne(index)) continue;
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wake.wait(lock, []() { return !running || pending > 0; });
+  }
+}
+
+bool JobSystem::RunOne(unsigned int index)
+{
+  Job job;
+  if (!Pop(index, job) && !Steal(index, job)) return false;
+
+  pending--;
+  job.func();
+  (*job.remaining)--;
+
+  return true;
+}
+
+bool JobSystem::Pop(unsigned int index, Job& job)
+{
+  Queue& q = *queues[index];
+  std::lock_guard<std::mutex> lock(q.mutex);
+
+  if (q.jobs.empty()) return false;
+
+  job = std::move(q.jobs.back());
+  q.jobs.pop_back();
+  return true;
+}
+
+bool JobSystem::Steal(unsigned int thief, Job& job)
+{
+  for (unsigned int i = 1; i < queues.size(); ++i) {
+    Queue& q = *queues[(thief + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+
+    if (q.jobs.empty()) continue;
+
+    job = std::move(q.jobs.front());
+    q.jobs.pop_front();
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+// Small work-stealing thread pool. Each worker owns a queue, takes its own
+// newest job first and steals the oldest from the others when it runs dry.
+// Threads waiting on work they submitted run jobs too, so nested calls
+// don't deadlock. Without Init (or with zero workers) everything runs
+// inline on the calling thread.
+class JobSystem
+{
+public:
+  static void Init(unsigned int numWorkers);
+  static void Shutdown();
+
+  static unsigned int GetWorkerCount() { return workers.size(); }
+
+  // Calls f(begin, end) over [0, count) in chunks of at most grain, and
+  // returns once every chunk is done. Chunks must not write shared state,
+  // then the result doesn't depend on which thread ran what.
+  static void ParallelFor(size_t count, size_t grain,
+      const std::function<void(size_t begin, size_t end)>& f);
+
+private:
+  JobSystem() {};
+
+  struct Job {
+    std::function<void()> func;
+    std::atomic<size_t>* remaining;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  static void WorkerLoop(unsigned int index);
+  // Runs one job from queue index, or stolen from another, if any
+  static bool RunOne(unsigned int index);
+  static bool Pop(unsigned int index, Job&);
+  static bool Steal(unsigned int thief, Job&);
+
+  static std::vector<std::thread> workers;
+  // One per worker, plus one shared by threads outside the pool
+  static std::vector<std::unique_ptr<Queue>> queues;
+
+  static std::mutex wakeMutex;
+  static std::condition_variable wake;
+  static std::atomic<bool> running;
+  static std::atomic<unsigned int> pending;
+  static std::atomic<unsigned int> nextQueue;
+
+  // Index of the calling thread's own queue
+  static thread_local unsigned int threadQueue;
+};
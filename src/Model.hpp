@@ -20,6 +20,11 @@ public:
   void draw() const;
   void drawWireframe() const;
 
+  // For renderers that set up their own vertex arrays over this model's
+  // geometry, e.g. InstanceBatch
+  unsigned int getVBO() const { return VBO; }
+  unsigned int getEBO() const { return EBO; }
+
 private:
   unsigned int VAO, VBO, EBO;
 };
@@ -0,0 +1,371 @@
+#include "Netplay.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#include "Simulation.hpp"
+#include "UdpSocket.hpp"
+
+namespace {
+
+const char MAGIC[4] = {'G', 'R', 'N', 'P'};
+const uint32_t VERSION = 1;
+const unsigned long NONE = ~0ul;
+
+enum PacketKind : uint8_t {
+  HELLO = 0,
+  INPUT = 1,
+};
+
+// Packs plain values into a packet, refusing anything past the end
+struct PacketWriter
+{
+  char* data;
+  size_t capacity;
+  size_t size;
+
+  template <typename T>
+  bool write(const T& value)
+  {
+    if (size + sizeof(T) > capacity) return false;
+    std::memcpy(data + size, &value, sizeof(T));
+    size += sizeof(T);
+    return true;
+  }
+};
+
+// Unpacks plain values, failing once the packet runs out
+struct PacketReader
+{
+  const char* data;
+  size_t size;
+  size_t offset;
+
+  template <typename T>
+  bool read(T& value)
+  {
+    if (offset + sizeof(T) > size) return false;
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+  }
+};
+
+NetplaySession::Input toInput(const ControllerData& c)
+{
+  NetplaySession::Input input = {};
+  for (int b : c.buttons) {
+    if (b >= 0 && b < NetplaySession::MAX_BUTTONS) input.buttons |= 1u << b;
+  }
+
+  for (size_t a = 0; a < c.axes.size() && a < NetplaySession::MAX_AXES; ++a) {
+    input.axes[a] = c.axes[a];
+  }
+
+  return input;
+}
+
+}
+
+bool NetplaySession::Input::operator==(const Input& i) const
+{
+  return buttons == i.buttons &&
+    std::memcmp(axes, i.axes, sizeof(axes)) == 0;
+}
+
+NetplaySession::NetplaySession(UdpSocket& s, int p, unsigned int sd,
+    const std::map<int, ControllerData>& local) :
+  socket(s),
+  peerIndex(p),
+  seed(sd),
+  gotPeerHello(false),
+  peerGotHello(false),
+  localControllers(local),
+  simulation(nullptr),
+  tickLength(0.0),
+  confirmedTicks(0),
+  peerConfirmedTicks(0),
+  rollbackTick(NONE),
+  rollbackCount(0),
+  resimulatedTicks(0),
+  maxRollback(0),
+  packet(MAX_PACKET_SIZE),
+  receivedPacket(MAX_PACKET_SIZE)
+{
+  for (auto& c : localControllers) {
+    if (c.second.axes.size() > MAX_AXES) c.second.axes.resize(MAX_AXES);
+    c.second.buttons.clear();
+
+    controllers[getNetworkID(c.first)] = c.second;
+  }
+}
+
+bool NetplaySession::connect()
+{
+  receive();
+  sendHello();
+
+  return gotPeerHello && peerGotHello;
+}
+
+void NetplaySession::sendHello()
+{
+  PacketWriter w = {packet.data(), packet.size(), 0};
+  for (char c : MAGIC) w.write(c);
+  w.write<uint8_t>(HELLO);
+  w.write<uint32_t>(VERSION);
+  w.write<uint8_t>(peerIndex);
+  w.write<uint8_t>(gotPeerHello);
+  w.write<uint32_t>(seed);
+
+  w.write<uint8_t>(localControllers.size());
+  for (const auto& c : localControllers) {
+    w.write<int32_t>(getNetworkID(c.first));
+    w.write<uint8_t>(c.second.axes.size());
+    for (float a : c.second.axes) w.write(a);
+  }
+
+  socket.send(w.data, w.size);
+}
+
+void NetplaySession::handleHello(const char* data, size_t size)
+{
+  PacketReader r = {data, size, 0};
+  uint32_t version, peerSeed;
+  uint8_t index, gotHello, count;
+
+  if (!r.read(version) || !r.read(index) || !r.read(gotHello) ||
+      !r.read(peerSeed) || !r.read(count)) return;
+
+  if (version != VERSION) {
+    std::cout << "Error: Peer runs netplay version " << version
+      << ", expected " << VERSION << std::endl;
+    return;
+  }
+
+  if (index == peerIndex) {
+    std::cout << "Error: Both peers are peer " << peerIndex << std::endl;
+    return;
+  }
+
+  if (gotHello) peerGotHello = true;
+  if (gotPeerHello) return;
+
+  std::map<int, ControllerData> remote;
+  for (int i = 0; i < count; ++i) {
+    int32_t id;
+    uint8_t numAxes;
+    if (!r.read(id) || !r.read(numAxes) || numAxes > MAX_AXES) return;
+
+    ControllerData& c = remote[id];
+    c.axes.resize(numAxes);
+    for (float& a : c.axes) {
+      if (!r.read(a)) return;
+    }
+  }
+
+  controllers.insert(remote.begin(), remote.end());
+  if (index == 0) seed = peerSeed;
+  gotPeerHello = true;
+}
+
+void NetplaySession::start(Simulation& s, double dt)
+{
+  simulation = &s;
+  tickLength = dt;
+
+  for (const auto& c : controllers) {
+    bool local = (c.first / CONTROLLERS_PER_PEER == peerIndex);
+    (local ? localSlots : remoteSlots).push_back(ids.size());
+    ids.push_back(c.first);
+
+    prediction.push_back(toInput(c.second));
+  }
+
+  inputs.assign(HISTORY * ids.size(), Input());
+  states.resize(HISTORY);
+}
+
+NetplaySession::Input* NetplaySession::getInputs(unsigned long tick)
+{
+  return &inputs[(tick % HISTORY) * ids.size()];
+}
+
+void NetplaySession::update()
+{
+  receive();
+
+  unsigned long tick = simulation->getTickCount();
+  if (rollbackTick < tick) {
+    simulation->restoreState(states[rollbackTick % HISTORY]);
+    for (unsigned long t = rollbackTick; t < tick; ++t) {
+      runTick(t);
+    }
+
+    unsigned long depth = tick - rollbackTick;
+    rollbackCount++;
+    resimulatedTicks += depth;
+    if (depth > maxRollback) maxRollback = depth;
+  }
+  rollbackTick = NONE;
+
+  sendInput();
+}
+
+bool NetplaySession::canAdvance() const
+{
+  return simulation->getTickCount() < confirmedTicks + MAX_ROLLBACK;
+}
+
+void NetplaySession::advance(const InputFrame& localFrame)
+{
+  for (const auto& a : localFrame.axes) {
+    auto it = localControllers.find(a.first);
+    if (it == localControllers.end()) continue;
+
+    std::vector<float>& axes = it->second.axes;
+    for (size_t i = 0; i < axes.size() && i < a.second.size(); ++i) {
+      axes[i] = a.second[i];
+    }
+  }
+
+  for (const auto& b : localFrame.buttons) {
+    auto it = localControllers.find(b.controllerID);
+    if (it == localControllers.end()) continue;
+
+    if (b.action) it->second.buttons.insert(b.button);
+    else it->second.buttons.erase(b.button);
+  }
+
+  unsigned long tick = simulation->getTickCount();
+  Input* in = getInputs(tick);
+  for (size_t s : localSlots) {
+    in[s] = toInput(localControllers[ids[s] - getNetworkID(0)]);
+  }
+
+  runTick(tick);
+  sendInput();
+}
+
+bool NetplaySession::isSynced() const
+{
+  return rollbackTick == NONE &&
+    confirmedTicks >= simulation->getTickCount();
+}
+
+void NetplaySession::runTick(unsigned long tick)
+{
+  Input* in = getInputs(tick);
+  if (tick >= confirmedTicks) {
+    for (size_t s : remoteSlots) in[s] = prediction[s];
+  }
+
+  simulation->saveState(states[tick % HISTORY]);
+
+  // Turn each controller's state into the events that get it there. The
+  // map keeps the same keys every tick, so refilling it doesn't allocate.
+  std::map<int, ControllerData>& current = simulation->getControllers();
+  frame.buttons.clear();
+
+  for (size_t s = 0; s < ids.size(); ++s) {
+    const ControllerData& c = current[ids[s]];
+
+    for (int b = 0; b < MAX_BUTTONS; ++b) {
+      bool down = in[s].buttons & (1u << b);
+      if (down != (c.buttons.count(b) > 0))
+	frame.buttons.push_back({ids[s], b, down});
+    }
+
+    frame.axes[ids[s]].assign(in[s].axes, in[s].axes + c.axes.size());
+  }
+
+  simulation->applyInput(frame);
+  simulation->tick(tickLength);
+}
+
+void NetplaySession::receive()
+{
+  std::vector<char>& buffer = receivedPacket;
+  while (size_t size = socket.receive(buffer.data(), buffer.size())) {
+    if (size < sizeof(MAGIC) + 1 ||
+	std::memcmp(buffer.data(), MAGIC, sizeof(MAGIC)) != 0) continue;
+
+    uint8_t kind = buffer[sizeof(MAGIC)];
+    const char* body = buffer.data() + sizeof(MAGIC) + 1;
+    size_t bodySize = size - sizeof(MAGIC) - 1;
+
+    if (kind == HELLO) {
+      handleHello(body, bodySize);
+    }
+    else if (kind == INPUT) {
+      // Input means the peer is through the handshake
+      peerGotHello = true;
+      if (simulation) handleInput(body, bodySize);
+    }
+  }
+}
+
+void NetplaySession::handleInput(const char* data, size_t size)
+{
+  PacketReader r = {data, size, 0};
+  uint32_t received, first;
+  uint8_t count;
+
+  if (!r.read(received) || !r.read(first) || !r.read(count)) return;
+
+  if (received > peerConfirmedTicks) peerConfirmedTicks = received;
+
+  unsigned long tick = simulation->getTickCount();
+
+  for (unsigned long t = first; t < first + count; ++t) {
+    // Anything after a gap, or too far ahead to store, comes again later
+    if (t > confirmedTicks || t >= tick + MAX_ROLLBACK) break;
+
+    Input* in = getInputs(t);
+    bool known = (t < confirmedTicks);
+
+    for (size_t s : remoteSlots) {
+      Input input;
+      if (!r.read(input)) return;
+      if (known) continue;
+
+      // Already ran this tick on a guess, and it was wrong
+      if (t < tick && in[s] != input && t < rollbackTick) rollbackTick = t;
+
+      in[s] = input;
+      prediction[s] = input;
+    }
+
+    if (!known) confirmedTicks = t + 1;
+  }
+}
+
+void NetplaySession::sendInput()
+{
+  unsigned long tick = simulation->getTickCount();
+
+  // Only the ticks still in the history can be sent
+  unsigned long first = peerConfirmedTicks;
+  if (tick >= HISTORY && first <= tick - HISTORY) first = tick - HISTORY + 1;
+
+  size_t tickSize = localSlots.size() * sizeof(Input);
+  size_t headerSize = sizeof(MAGIC) + 1 + 2*sizeof(uint32_t) + 1;
+  unsigned long count = tick - first;
+  if (count > 255) count = 255;
+  if (tickSize > 0 && count > (MAX_PACKET_SIZE - headerSize) / tickSize)
+    count = (MAX_PACKET_SIZE - headerSize) / tickSize;
+
+  PacketWriter w = {packet.data(), packet.size(), 0};
+  for (char c : MAGIC) w.write(c);
+  w.write<uint8_t>(INPUT);
+  w.write<uint32_t>(confirmedTicks);
+  w.write<uint32_t>(first);
+  w.write<uint8_t>(count);
+
+  for (unsigned long t = first; t < first + count; ++t) {
+    const Input* in = getInputs(t);
+    for (size_t s : localSlots) w.write(in[s]);
+  }
+
+  socket.send(w.data, w.size);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "ControllerData.hpp"
+#include "InputFrame.hpp"
+#include "SimulationState.hpp"
+
+class Simulation;
+class UdpSocket;
+
+// Two-player rollback netplay. Each peer runs its own Simulation from the
+// same seed and controllers, and only input crosses the network. A tick
+// doesn't wait for the remote input: it predicts the peer's controllers
+// are still held as in their last known tick. When the real input arrives
+// and differs, the simulation is restored to the first mispredicted tick
+// and run forward again with it.
+//
+// Input is sent as controller state per tick rather than button events,
+// so a press and release within one tick is lost. Every packet carries
+// all input the peer hasn't acknowledged yet, so a lost packet only
+// delays input until the next one.
+//
+// Tasks added with Simulation::addTask run again for every resimulated
+// tick without being restored, so per-frame presentation like the camera
+// should update outside the simulation instead.
+//
+// Controllers are renumbered peerIndex * CONTROLLERS_PER_PEER + local id,
+// so both peers see the same ids.
+//
+// Packets, host byte order:
+//   char[4]  "GRNP"
+//   uint8    kind
+//   HELLO:   uint32 version, uint8 peer index, uint8 got peer's hello,
+//            uint32 seed, uint8 controller count, then per controller:
+//              int32 id, uint8 axis count, float32 axes[count]
+//   INPUT:   uint32 peer ticks received, uint32 first tick, uint8 count,
+//            then per tick, per sender's controller: Input
+class NetplaySession
+{
+public:
+  static constexpr int CONTROLLERS_PER_PEER = 16;
+  // Buttons beyond 32 and axes beyond MAX_AXES aren't sent
+  static constexpr int MAX_BUTTONS = 32;
+  static constexpr int MAX_AXES = 8;
+  // Furthest a peer may run ahead of the input it has from the other
+  static constexpr unsigned long MAX_ROLLBACK = 8;
+
+  // Controller state for one tick, as sent
+  struct Input {
+    uint32_t buttons;
+    float axes[MAX_AXES];
+
+    bool operator==(const Input&) const;
+    bool operator!=(const Input& i) const { return !(*this == i); }
+  };
+
+  // The socket must already have its peer set. Peer 0 picks the seed,
+  // the other's is ignored. localControllers are keyed by local id.
+  NetplaySession(UdpSocket&, int peerIndex, unsigned int seed,
+      const std::map<int, ControllerData>& localControllers);
+
+  // Exchanges seeds and controllers. Call until it returns true, then
+  // make the Simulation from getSeed() and getControllers().
+  bool connect();
+  unsigned int getSeed() const { return seed; }
+  // Both peers' controllers, by network id
+  const std::map<int, ControllerData>& getControllers() const {
+    return controllers;
+  }
+  // Local controllers by local id, as of the last advance
+  const std::map<int, ControllerData>& getLocalControllers() const {
+    return localControllers;
+  }
+  int getNetworkID(int localID) const {
+    return peerIndex * CONTROLLERS_PER_PEER + localID;
+  }
+
+  // Simulation must be started and made from this session's seed and
+  // controllers, and only ticked through the session from here
+  void start(Simulation&, double tickLength);
+
+  // After start(). Receives input, rolls back and resimulates if it
+  // changed any tick already run, and sends the local input the peer
+  // doesn't have yet
+  void update();
+  // False while too far ahead of the peer's input, keep calling update()
+  bool canAdvance() const;
+  // Runs the next tick with the local controllers updated by frame
+  // (local ids), and the remote ones predicted
+  void advance(const InputFrame&);
+  // Every tick run so far used the peer's real input
+  bool isSynced() const;
+
+  unsigned long getRollbackCount() const { return rollbackCount; }
+  unsigned long getResimulatedTicks() const { return resimulatedTicks; }
+  unsigned long getMaxRollback() const { return maxRollback; }
+
+private:
+  static constexpr size_t HISTORY = 2 * MAX_ROLLBACK + 2;
+  static constexpr size_t MAX_PACKET_SIZE = 1400;
+
+  UdpSocket& socket;
+  int peerIndex;
+  unsigned int seed;
+
+  // Handshake
+  bool gotPeerHello;
+  bool peerGotHello;
+  void sendHello();
+
+  std::map<int, ControllerData> localControllers;
+  std::map<int, ControllerData> controllers;
+
+  // Controllers in id order, the order inputs are stored and sent in
+  std::vector<int> ids;
+  std::vector<size_t> localSlots;
+  std::vector<size_t> remoteSlots;
+
+  Simulation* simulation;
+  double tickLength;
+
+  // Input each of the last HISTORY ticks ran with, ids.size() per tick,
+  // and the state before it. Remote input for ticks not run yet is
+  // stored ahead as it arrives.
+  std::vector<Input> inputs;
+  std::vector<SimulationState> states;
+  Input* getInputs(unsigned long tick);
+
+  // Remote input is known for ticks before this
+  unsigned long confirmedTicks;
+  // The peer has local input for ticks before this
+  unsigned long peerConfirmedTicks;
+  // Earliest tick run with a wrong prediction
+  unsigned long rollbackTick;
+  // Last confirmed remote input, by slot
+  std::vector<Input> prediction;
+
+  unsigned long rollbackCount;
+  unsigned long resimulatedTicks;
+  unsigned long maxRollback;
+
+  // Scratch
+  InputFrame frame;
+  std::vector<char> packet;
+  std::vector<char> receivedPacket;
+
+  void runTick(unsigned long tick);
+  void receive();
+  void handleHello(const char* data, size_t size);
+  void handleInput(const char* data, size_t size);
+  void sendInput();
+};
@@ -3,14 +3,12 @@
 #include <vector>
 #include <algorithm>
 
-#include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/rotate_vector.hpp>
 
 #include "geo.hpp"
-#include "ResourceManager.hpp"
 #include "Console.hpp"
 
 Player::Player()
@@ -25,6 +23,11 @@ Player::Player()
   angle = 0.f;
   aimDirection = 0.f;
 
+  previousPosition = position;
+  previousAngle = angle;
+  previousAimDirection = aimDirection;
+  updateBounds();
+
   // Initial state
   health = STARTING_HEALTH;
   lives = STARTING_LIVES;
@@ -51,17 +54,32 @@ glm::vec2 Player::getCenterPosition() const
   return position + glm::vec2(relativeCenter);
 }
 
+void Player::updateBounds()
+{
+  float s = glm::sin(angle);
+  float c = glm::cos(angle);
+
+  // Box corners relative to position, before rotation
+  const glm::vec2 box[4] = {
+    {-SIZE, 0.f}, {SIZE, 0.f}, {SIZE, 2*SIZE}, {-SIZE, 2*SIZE}
+  };
+
+  for (int i = 0; i < 4; ++i) {
+    corners[i] = position +
+      glm::vec2(c*box[i].x - s*box[i].y, s*box[i].x + c*box[i].y);
+  }
+
+  boundsMin = glm::min(glm::min(corners[0], corners[1]),
+      glm::min(corners[2], corners[3]));
+  boundsMax = glm::max(glm::max(corners[0], corners[1]),
+      glm::max(corners[2], corners[3]));
+}
+
 bool Player::collidesWith(glm::vec2 p) const
 {
-  glm::vec2 a = 
-    glm::vec2(glm::rotate(glm::vec3(-SIZE, 0.f, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
-  glm::vec2 b =
-    glm::vec2(glm::rotate(glm::vec3(SIZE, 0.f, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
-  glm::vec2 d =
-    glm::vec2(glm::rotate(glm::vec3(-SIZE, 2*SIZE, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
+  const glm::vec2& a = corners[0];
+  const glm::vec2& b = corners[1];
+  const glm::vec2& d = corners[3];
 
   float v1 = glm::dot(a-p, a-b);
   float v2 = glm::dot(a-p, a-d);
@@ -78,18 +96,10 @@ bool Player::collidesWith(glm::vec2 p) const
 
 bool Player::collidesWith(glm::vec2 p1, glm::vec2 p2) const
 {
-  glm::vec2 a = 
-    glm::vec2(glm::rotate(glm::vec3(-SIZE, 0.f, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
-  glm::vec2 b =
-    glm::vec2(glm::rotate(glm::vec3(SIZE, 0.f, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
-  glm::vec2 c =
-    glm::vec2(glm::rotate(glm::vec3(SIZE, 2*SIZE, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
-  glm::vec2 d =
-    glm::vec2(glm::rotate(glm::vec3(-SIZE, 2*SIZE, 0.f), angle, {0.f, 0.f, 1.f}))
-    + position;
+  const glm::vec2& a = corners[0];
+  const glm::vec2& b = corners[1];
+  const glm::vec2& c = corners[2];
+  const glm::vec2& d = corners[3];
 
   if (geo::hasIntersection(p1, p2, a, b) ||
       geo::hasIntersection(p1, p2, b, c) ||
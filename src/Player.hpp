@@ -4,8 +4,10 @@
 #include <glm/vec2.hpp>
 #include <glm/glm.hpp>
 #include "Grenade.hpp"
+#include "FixedVector.hpp"
 
 struct GrenadeSlot {
+  GrenadeSlot() = default;
   GrenadeSlot(Grenade::Type t, int a) :
     type(t), ammo(a)
   {}
@@ -40,6 +42,8 @@ struct Player {
   //////////////////////////////////////////////
 
   glm::vec2 getCenterPosition() const;
+  // Recompute corners and bounds, after position or angle change
+  void updateBounds();
   // Collide with point
   bool collidesWith(glm::vec2) const;
   // Collide with line
@@ -61,10 +65,21 @@ struct Player {
   float angle;
   float aimDirection;
 
+  // Physics state at the start of the current tick, for render interpolation
+  glm::vec2 previousPosition;
+  float previousAngle;
+  float previousAimDirection;
+
+  // Rotated box as of the last updateBounds: bottom left, bottom right,
+  // top right, top left, and its axis aligned bounds
+  glm::vec2 corners[4];
+  glm::vec2 boundsMin;
+  glm::vec2 boundsMax;
+
   // State
   float health;
   int lives;
-  std::vector<GrenadeSlot> inventory;
+  FixedVector<GrenadeSlot, INVENTORY_SIZE> inventory;
   int primaryGrenadeSlot;
   int secondaryGrenadeSlot;
 
@@ -18,6 +18,7 @@
 #include <glm/gtc/constants.hpp>
 
 #include <iostream>
+#include <algorithm>
 
 PlayerSystem::PlayerSystem(
     const Terrain& t,
@@ -25,7 +26,8 @@ PlayerSystem::PlayerSystem(
     const TimescaleSystem& ts) :
   terrain(t),
   controllers(c),
-  timescaleSystem(ts)
+  timescaleSystem(ts),
+  grid(0.f, t.getMaxWidth(), GRID_CELL_SIZE)
 {
   // Add player per controller
   for (const auto& c : controllers) {
@@ -50,11 +52,19 @@ PlayerSystem::PlayerSystem(
   player.position.x = terrain.getMaxWidth() / 2 - 100.f;
   player.controllerID = -1;
 
-  EventManager::Register(Event::EXPLOSION,
-      std::bind(&PlayerSystem::onExplosion, this, _1));
+  updateGrid();
 
-  EventManager::Register(Event::POWERUP_PICKUP,
-      std::bind(&PlayerSystem::onPowerupPickup, this, _1));
+  eventHandles.push_back(EventManager::Register<EvdGrenadeExplosion>(
+      std::bind(&PlayerSystem::onExplosion, this, _1, _2), this));
+
+  eventHandles.push_back(EventManager::Register<EvdPowerupPickup>(
+      std::bind(&PlayerSystem::onPowerupPickup, this, _1, _2), this));
+}
+
+PlayerSystem::~PlayerSystem()
+{
+  for (auto h : eventHandles)
+    EventManager::Unregister(h);
 }
 
 const Player& PlayerSystem::getPlayer(int id) const
@@ -62,176 +72,63 @@ const Player& PlayerSystem::getPlayer(int id) const
   return players[id];
 }
 
-void PlayerSystem::update(double t, double gdt)
+void PlayerSystem::queryPlayers(glm::vec2 min, glm::vec2 max,
+    std::vector<int>& ids) const
 {
-  for (auto& p : players) {
-    double newTimescale =
-      timescaleSystem.getTimescaleAtPosition(p.getCenterPosition());
-    double dt = newTimescale * gdt;
-
-    std::vector<float> axes(6, 0.0f);
-
-    if (p.controllerID != -1) {
-      axes = controllers.at(p.controllerID).axes;
-    }
-
-    // Aiming
-    ////////////////////////////////////////////////////
-
-    // Deadzone
-    if (pow(axes[0], 2) + pow(axes[1], 2)
-	< pow(Player::MOVEMENT_DEADZONE, 2)) {
-      axes[0] = 0.f;
-      axes[1] = 0.f;
-    } else {
-      p.lastMovingRight = axes[0] > 0.f;
-    }
-
-    float aimSpeed;
-    if (!p.firingBeam) aimSpeed = Player::AIM_SPEED;
-    else aimSpeed = Player::AIM_SPEED_BEAM;
-
-    float currentAngle = p.aimDirection;
-    float targetAngle;
-    if (axes[0] == 0.f && axes[1] == 0.f) {
-      targetAngle = -p.angle +
-	(int)!p.lastMovingRight * glm::pi<float>();
-    } else {
-      targetAngle = glm::atan(axes[1], axes[0]);
-    }
-
-    float angleDiff = fabs(targetAngle - currentAngle);
-    if (angleDiff > glm::pi<float>()) {
-      if (targetAngle > currentAngle) currentAngle += glm::two_pi<float>();
-      else targetAngle += glm::two_pi<float>();
-    }
-    float newAngle = currentAngle +
-      (aimSpeed * dt * (targetAngle - currentAngle));
-
-    if (newAngle >= 0.f && newAngle < glm::two_pi<float>())
-      p.aimDirection = newAngle;
-    else
-      p.aimDirection = fmod(newAngle, glm::two_pi<float>());
-
-    // Movement
-    ////////////////////////////////////////////////////
-
-    // -------- Acceleration --------
-    float accel_factor = Player::ACCEL_X;
-
-    if (p.respawning) {
-    }
-    else if (p.airborne)
-      accel_factor = Player::ACCEL_X_AIRBORNE;
-    else if (p.airborne && (p.outOfControl || p.firingBeam))
-      accel_factor = Player::ACCEL_X_AIRBORNE_NOCONTROL;
-    else if (!p.airborne && (p.outOfControl || p.firingBeam))
-      accel_factor = Player::ACCEL_X_NOCONTROL;
-
-    // Acceleration due to player input
-    if (p.respawning || (!p.outOfControl && !p.firingBeam)) {
-      p.acceleration.x = axes[0] * accel_factor;
-    } else {
-      p.acceleration.x = 0.f;
-    }
-
-    // Drag to oppose velocity
-    p.acceleration.x -= accel_factor / Player::MAX_SPEED * p.velocity.x;
-
-    // Gravity
-    if (p.airborne && !p.respawning) {
-      p.acceleration.y = Player::ACCEL_Y;
-    }
-    else {
-      p.acceleration.y = 0;
-    }
-
-    // -------- Velocity --------
-    p.velocity += p.acceleration * (float)dt;
-
-    if (p.respawning) {
-      p.velocity.y = 0;
-    }
-
-    glm::vec2 maxNewPosition = p.position + p.velocity * (float)dt;
-
-    float terrainAngle = terrain.getAngle(maxNewPosition.x);
-    if (!p.airborne &&
-	glm::sign(terrainAngle) == glm::sign(p.velocity.x)) {
-      p.velocity *= glm::cos(terrainAngle);
-    }
-
-    // -------- Position --------
-    glm::vec2 newPosition = p.position + p.velocity * (float)dt;
-
-    // Stick to ground if on ground
-    if (!p.airborne) {
-      if (abs(terrainAngle) > Player::MAX_DOWNHILL_ANGLE &&
-	  glm::sign(p.velocity.x) != glm::sign(terrainAngle)) {
-	p.dirty_justLeftGround = true;
-	p.airborne = true;
-      }
-      else {
-	p.position = newPosition;
-	p.position.y = terrain.getHeight(newPosition.x);
-      }
-    }
-
-    if (p.airborne) {
-      if (!p.dirty_justLeftGround) {
-	auto intersection = terrain.intersect(p.position, newPosition);
-	if (intersection.first) {
-	  p.velocity.y = 0.f;
-	  p.airborne = false;
-	  p.outOfControl = false;
-	  p.jumpAvailable = true;
-	  break;
-	}
-
-	// Failsafe
-	if (!intersection.first && newPosition.y <
-	    terrain.getHeight(newPosition.x))
-	  newPosition.y = terrain.getHeight(newPosition.x);
-      } else {
-	p.dirty_justLeftGround = false;
-      }
-
-      // Double super extreme failsafe
-      if (newPosition.y < terrain.getHeight(newPosition.x)) {
-	newPosition.y = terrain.getHeight(newPosition.x);
-      }
-
-      p.position = newPosition;
+  grid.query(min.x, max.x, ids);
+
+  ids.erase(std::remove_if(ids.begin(), ids.end(),
+	[&](int id) -> bool {
+	const Player& p = players[id];
+	return p.boundsMax.y < min.y || p.boundsMin.y > max.y ||
+	p.boundsMax.x < min.x || p.boundsMin.x > max.x;
+	}), ids.end());
+}
 
-      if (p.respawning) {
-	p.position.y = 100.f;
-      }
-    }
+void PlayerSystem::saveState(State& s) const
+{
+  s.players = players;
+}
 
-    // World boundary
-    float terrainMaxWidth = terrain.getMaxWidth();
-    if (p.position.x - Player::SIZE < 0)
-      p.position.x = Player::SIZE;
-    else if (p.position.x + Player::SIZE > terrainMaxWidth)
-      p.position.x = terrainMaxWidth - Player::SIZE;
+void PlayerSystem::restoreState(const State& s)
+{
+  players = s.players;
+  updateGrid();
+}
 
-    // -------- Angle --------
-    float goalAngle = terrainAngle;
+void PlayerSystem::updateGrid()
+{
+  grid.clear();
 
-    float terrainHeight = terrain.getHeight(p.position.x);
-    float heightModifier = (p.position.y - terrainHeight) / 180.f;
-    if (heightModifier < 0.f) heightModifier = 0.f;
-    if (heightModifier > 1.f) heightModifier = 1.f;
+  for (auto& p : players) {
+    p.updateBounds();
+    grid.insert(p.id, p.boundsMin.x, p.boundsMax.x);
+  }
+}
 
-    float velocityModifier = p.velocity.x / Player::MAX_SPEED;
-    if (velocityModifier > 1.0f) velocityModifier = 1.0f;
+void PlayerSystem::update(double t, double gdt)
+{
+  for (auto& p : players) {
+    p.previousPosition = p.position;
+    p.previousAngle = p.angle;
+    p.previousAimDirection = p.aimDirection;
+  }
 
-    // Slightly tilt towards velocity direction
-    goalAngle += heightModifier *
-      (-glm::radians(15.f) * velocityModifier - goalAngle);
+  centers.resize(players.size());
+  timescales.resize(players.size());
+  for (size_t i = 0; i < players.size(); ++i) {
+    centers[i] = players[i].getCenterPosition();
+  }
+  if (!players.empty())
+    timescaleSystem.getTimescales(&centers[0], &timescales[0], players.size());
 
-    p.angle += 14.f * dt * (goalAngle - p.angle);
+  // A player's move is a microsecond or two, less than handing it to
+  // a worker costs, so they stay on this thread
+  for (size_t i = 0; i < players.size(); ++i) {
+    updatePhysics(players[i], timescales[i] * gdt);
+  }
 
+  for (auto& p : players) {
     // Health
     if (p.health <= 0.f) {
       if (!p.undying)
@@ -241,6 +138,8 @@ void PlayerSystem::update(double t, double gdt)
     }
   }
 
+  updateGrid();
+
   // ImGui::Begin("Players", NULL, ImGuiWindowFlags_NoCollapse);
   // for (auto& p : players) {
   //   std::stringstream header_label;
@@ -270,6 +169,174 @@ void PlayerSystem::update(double t, double gdt)
   // ImGui::End();
 }
 
+void PlayerSystem::updatePhysics(Player& p, double dt)
+{
+  // Copied so the deadzone can zero them, without allocating per tick
+  float axes[6] = {};
+
+  if (p.controllerID != -1) {
+    const std::vector<float>& c = controllers.at(p.controllerID).axes;
+    for (size_t i = 0; i < c.size() && i < 6; ++i) axes[i] = c[i];
+  }
+
+  // Aiming
+  ////////////////////////////////////////////////////
+
+  // Deadzone
+  if (pow(axes[0], 2) + pow(axes[1], 2)
+      < pow(Player::MOVEMENT_DEADZONE, 2)) {
+    axes[0] = 0.f;
+    axes[1] = 0.f;
+  } else {
+    p.lastMovingRight = axes[0] > 0.f;
+  }
+
+  float aimSpeed;
+  if (!p.firingBeam) aimSpeed = Player::AIM_SPEED;
+  else aimSpeed = Player::AIM_SPEED_BEAM;
+
+  float currentAngle = p.aimDirection;
+  float targetAngle;
+  if (axes[0] == 0.f && axes[1] == 0.f) {
+    targetAngle = -p.angle +
+      (int)!p.lastMovingRight * glm::pi<float>();
+  } else {
+    targetAngle = glm::atan(axes[1], axes[0]);
+  }
+
+  float angleDiff = fabs(targetAngle - currentAngle);
+  if (angleDiff > glm::pi<float>()) {
+    if (targetAngle > currentAngle) currentAngle += glm::two_pi<float>();
+    else targetAngle += glm::two_pi<float>();
+  }
+  float newAngle = currentAngle +
+    (aimSpeed * dt * (targetAngle - currentAngle));
+
+  if (newAngle >= 0.f && newAngle < glm::two_pi<float>())
+    p.aimDirection = newAngle;
+  else
+    p.aimDirection = fmod(newAngle, glm::two_pi<float>());
+
+  // Movement
+  ////////////////////////////////////////////////////
+
+  // -------- Acceleration --------
+  float accel_factor = Player::ACCEL_X;
+
+  if (p.respawning) {
+  }
+  else if (p.airborne)
+    accel_factor = Player::ACCEL_X_AIRBORNE;
+  else if (p.airborne && (p.outOfControl || p.firingBeam))
+    accel_factor = Player::ACCEL_X_AIRBORNE_NOCONTROL;
+  else if (!p.airborne && (p.outOfControl || p.firingBeam))
+    accel_factor = Player::ACCEL_X_NOCONTROL;
+
+  // Acceleration due to player input
+  if (p.respawning || (!p.outOfControl && !p.firingBeam)) {
+    p.acceleration.x = axes[0] * accel_factor;
+  } else {
+    p.acceleration.x = 0.f;
+  }
+
+  // Drag to oppose velocity
+  p.acceleration.x -= accel_factor / Player::MAX_SPEED * p.velocity.x;
+
+  // Gravity
+  if (p.airborne && !p.respawning) {
+    p.acceleration.y = Player::ACCEL_Y;
+  }
+  else {
+    p.acceleration.y = 0;
+  }
+
+  // -------- Velocity --------
+  p.velocity += p.acceleration * (float)dt;
+
+  if (p.respawning) {
+    p.velocity.y = 0;
+  }
+
+  glm::vec2 maxNewPosition = p.position + p.velocity * (float)dt;
+
+  float terrainAngle = terrain.getAngle(maxNewPosition.x);
+  if (!p.airborne &&
+      glm::sign(terrainAngle) == glm::sign(p.velocity.x)) {
+    p.velocity *= glm::cos(terrainAngle);
+  }
+
+  // -------- Position --------
+  glm::vec2 newPosition = p.position + p.velocity * (float)dt;
+
+  // Stick to ground if on ground
+  if (!p.airborne) {
+    if (abs(terrainAngle) > Player::MAX_DOWNHILL_ANGLE &&
+	glm::sign(p.velocity.x) != glm::sign(terrainAngle)) {
+      p.dirty_justLeftGround = true;
+      p.airborne = true;
+    }
+    else {
+      p.position = newPosition;
+      p.position.y = terrain.getHeight(newPosition.x);
+    }
+  }
+
+  if (p.airborne) {
+    if (!p.dirty_justLeftGround) {
+      auto intersection = terrain.intersect(p.position, newPosition);
+      if (intersection.first) {
+	p.velocity.y = 0.f;
+	p.airborne = false;
+	p.outOfControl = false;
+	p.jumpAvailable = true;
+	return;
+      }
+
+      // Failsafe
+      if (!intersection.first && newPosition.y <
+	  terrain.getHeight(newPosition.x))
+	newPosition.y = terrain.getHeight(newPosition.x);
+    } else {
+      p.dirty_justLeftGround = false;
+    }
+
+    // Double super extreme failsafe
+    if (newPosition.y < terrain.getHeight(newPosition.x)) {
+      newPosition.y = terrain.getHeight(newPosition.x);
+    }
+
+    p.position = newPosition;
+
+    if (p.respawning) {
+      p.position.y = 100.f;
+    }
+  }
+
+  // World boundary
+  float terrainMaxWidth = terrain.getMaxWidth();
+  if (p.position.x - Player::SIZE < 0)
+    p.position.x = Player::SIZE;
+  else if (p.position.x + Player::SIZE > terrainMaxWidth)
+    p.position.x = terrainMaxWidth - Player::SIZE;
+
+  // -------- Angle --------
+  float goalAngle = terrainAngle;
+
+  float terrainHeight = terrain.getHeight(p.position.x);
+  float heightModifier = (p.position.y - terrainHeight) / 180.f;
+  if (heightModifier < 0.f) heightModifier = 0.f;
+  if (heightModifier > 1.f) heightModifier = 1.f;
+
+  float velocityModifier = p.velocity.x / Player::MAX_SPEED;
+  if (velocityModifier > 1.0f) velocityModifier = 1.0f;
+
+  // Slightly tilt towards velocity direction
+  goalAngle += heightModifier *
+    (-glm::radians(15.f) * velocityModifier - goalAngle);
+
+  p.angle += 14.f * dt * (goalAngle - p.angle);
+}
+
 void PlayerSystem::processInput(int controllerID, int button, bool action)
 {
   auto it = std::find_if(players.begin(), players.end(),
@@ -277,6 +344,7 @@ void PlayerSystem::processInput(int controllerID, int button, bool action)
       return p.controllerID == controllerID;
       });
 
+  if (it == players.end()) return;
   Player& player = *it;
 
   if (player.respawning) {
@@ -343,8 +411,12 @@ void PlayerSystem::throwGrenade(Player& p)
   if (p.inventory.size() == 0) return;
 
   EvdPlayerThrowGrenade d;
-  d.player = &p;
-  EventManager::Send(Event::PLAYER_THROW_GRENADE, d);
+  d.playerID = p.id;
+  d.grenadeType = p.inventory[p.primaryGrenadeSlot].type;
+  d.position = p.getCenterPosition();
+  d.velocity = p.velocity;
+  d.aimDirection = p.aimDirection;
+  EventManager::Send(d);
 
   p.combinationEnabled = false;
   p.secondaryGrenadeSlot = 0;
@@ -363,8 +435,8 @@ void PlayerSystem::throwGrenade(Player& p)
 void PlayerSystem::detonateGrenade(Player& p)
 {
   EvdPlayerDetonateGrenade d;
-  d.player = &p;
-  EventManager::Send(Event::PLAYER_DETONATE_GRENADE, d);
+  d.playerID = p.id;
+  EventManager::Send(d);
 }
 
 void PlayerSystem::cycleGrenade(Player& p)
@@ -415,8 +487,8 @@ void PlayerSystem::kill(Player& p)
   }
 
   EvdPlayerDeath d;
-  d.player = &p;
-  EventManager::Send(Event::PLAYER_DEATH, d);
+  d.playerID = p.id;
+  EventManager::Send(d);
 }
 
 void PlayerSystem::respawn(Player& p)
@@ -429,38 +501,39 @@ void PlayerSystem::respawn(Player& p)
   p.health = Player::STARTING_HEALTH;
 }
 
-void PlayerSystem::onExplosion(const Event& e)
+void PlayerSystem::onExplosion(const Event&, const EvdGrenadeExplosion& d)
 {
-  const auto* g = boost::any_cast<EvdGrenadeExplosion>(e.data).grenade;
+  const auto& properties = Grenade::getProperties(d.type);
 
   for (auto& p : players) {
 
     // Teleport
-    if (g->owner == p.id &&
-	g->properties.teleportPlayerOnDetonate) {
-      p.position = g->position;
+    if (d.owner == p.id &&
+	properties.teleportPlayerOnDetonate) {
+      p.position = d.position;
+      updateGrid();
       p.airborne = true;
       p.jumpAvailable = false;
 
       if (p.velocity.y < 0.f) p.velocity.y = 0.f;
     }
 
-    glm::vec2 diff = p.getCenterPosition() - g->position;
+    glm::vec2 diff = p.getCenterPosition() - d.position;
     float dist = glm::length(diff);
 
-    if (dist >= g->properties.radius) continue;
+    if (dist >= properties.radius) continue;
     if (p.ghost) continue;
 
     // Damage falloff
-    float damage = g->properties.damage;
+    float damage = properties.damage;
 
     if (dist > 42.f) {
-      damage = g->properties.damage * 
-	(1 - glm::pow((dist / g->properties.radius), 0.74f));
+      damage = properties.damage * 
+	(1 - glm::pow((dist / properties.radius), 0.74f));
     }
 
-    if (damage < 0.1*g->properties.damage)
-      damage = 0.1 * g->properties.damage;
+    if (damage < 0.1*properties.damage)
+      damage = 0.1 * properties.damage;
 
     p.health -= damage;
 
@@ -470,12 +543,12 @@ void PlayerSystem::onExplosion(const Event& e)
 
     glm::vec2 launchVelocity;
 
-    launchVelocity.x = g->properties.knockback * 
-      glm::pow( (g->properties.radius-dist)/g->properties.radius, 0.5);
+    launchVelocity.x = properties.knockback * 
+      glm::pow( (properties.radius-dist)/properties.radius, 0.5);
     launchVelocity.x *= glm::sign(diff.x);
 
-    launchVelocity.y = g->properties.knockback *
-      glm::pow( (g->properties.radius-dist)/g->properties.radius, 0.5);
+    launchVelocity.y = properties.knockback *
+      glm::pow( (properties.radius-dist)/properties.radius, 0.5);
 
     // If we are very close in x, dont launch much in x
     if (glm::abs(diff.x) < 1.5f * Player::SIZE) {
@@ -486,12 +559,8 @@ void PlayerSystem::onExplosion(const Event& e)
   }
 }
 
-void PlayerSystem::onPowerupPickup(const Event& e)
+void PlayerSystem::onPowerupPickup(const Event&, const EvdPowerupPickup& d)
 {
-  auto d = boost::any_cast<EvdPowerupPickup>(e.data);
-
-  Player* player = const_cast<Player*>(d.player);
-  const Powerup* powerup = d.powerup;
-
-  player->giveGrenade(Grenade::Type(powerup->type), 5);
+  Player& player = players[d.playerID];
+  player.giveGrenade(Grenade::Type(d.powerup.type), 5);
 }
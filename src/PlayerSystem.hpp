@@ -3,6 +3,8 @@
 #include <vector>
 #include <map>
 #include "ControllerData.hpp"
+#include "EventManager.hpp"
+#include "SpatialGrid.hpp"
 
 #include "Player.hpp"
 
@@ -19,6 +21,15 @@ public:
       const std::map<int, ControllerData>&,
       const TimescaleSystem&
       );
+  ~PlayerSystem();
+
+  struct State {
+    std::vector<Player> players;
+  };
+
+  // Copies into s, reusing its storage
+  void saveState(State& s) const;
+  void restoreState(const State&);
 
   void update(double t, double dt);
   void processInput(int controllerID, int button, bool action);
@@ -33,13 +44,31 @@ public:
   const std::vector<Player>& getPlayers() const { return players; };
   const Player& getPlayer(int id) const;
 
+  // Replaces ids with the players whose bounds overlap the box
+  // [min, max], in id order
+  void queryPlayers(glm::vec2 min, glm::vec2 max, std::vector<int>& ids) const;
+
+  static constexpr float GRID_CELL_SIZE = 128.f;
+
 private:
   std::vector<Player> players;
 
+  // Movement and aim for one player over dt of its local time
+  void updatePhysics(Player&, double dt);
+
+  // Player centres and the timescales there, for this update
+  std::vector<glm::vec2> centers;
+  std::vector<double> timescales;
+
   const Terrain& terrain;
   const std::map<int, ControllerData>& controllers;
   const TimescaleSystem& timescaleSystem;
 
-  void onExplosion(const Event&);
-  void onPowerupPickup(const Event&);
+  // Broadphase over player bounds, rebuilt at the end of each update
+  SpatialGrid grid;
+  void updateGrid();
+
+  void onExplosion(const Event&, const EvdGrenadeExplosion&);
+  void onPowerupPickup(const Event&, const EvdPowerupPickup&);
+  std::vector<EventManager::Handle> eventHandles;
 };
@@ -12,12 +12,31 @@
 #include "Console.hpp"
 
 PowerupSystem::PowerupSystem(const Terrain& t, const PlayerSystem& p) :
+  random(Random::stream(Random::POWERUPS)),
   terrain(t),
   playerSystem(p)
 {
-  EventManager::Register(Event::GAME_START, [this](Event) {
+  gameStartHandle = EventManager::Register<EvdGameStart>(
+      [this](const Event&, const EvdGameStart&) {
       this->spawnPowerup();
-      });
+      }, this);
+}
+
+PowerupSystem::~PowerupSystem()
+{
+  EventManager::Unregister(gameStartHandle);
+}
+
+void PowerupSystem::saveState(State& s) const
+{
+  s.powerups = powerups;
+  s.randomCounter = random.getCounter();
+}
+
+void PowerupSystem::restoreState(const State& s)
+{
+  powerups = s.powerups;
+  random.setCounter(s.randomCounter);
 }
 
 void PowerupSystem::update(double dt)
@@ -41,8 +60,8 @@ void PowerupSystem::update(double dt)
 	p.position = intersection.second;
 
 	EvdPowerupLand d;
-	d.powerup = &p;
-	EventManager::Send(Event::Type::POWERUP_LAND, d);
+	d.powerup = p;
+	EventManager::Send(d);
       } else {
 	p.position = newPosition;
       }
@@ -53,18 +72,20 @@ void PowerupSystem::update(double dt)
 	p.position.y = terrain.getHeight(p.position.x);
 
       // Check if any player is in pickup range
-      const auto& players = playerSystem.getPlayers();
-      auto i = std::find_if(players.begin(), players.end(),
-	  [&](const Player& player) {
-	  float dx = glm::distance(player.position, p.position);
+      playerSystem.queryPlayers(p.position - glm::vec2(16.f),
+	  p.position + glm::vec2(16.f), nearbyPlayers);
+
+      auto i = std::find_if(nearbyPlayers.begin(), nearbyPlayers.end(),
+	  [&](int id) {
+	  float dx = glm::distance(playerSystem.getPlayer(id).position, p.position);
 	  return dx < 16.f;
 	  });
 
-      if (i != players.end()) {
+      if (i != nearbyPlayers.end()) {
 	EvdPowerupPickup d;
-	d.player = &*i;
-	d.powerup = &p;
-	EventManager::Send(Event::POWERUP_PICKUP, d);
+	d.playerID = *i;
+	d.powerup = p;
+	EventManager::Send(d);
 	p.dirty_awaitingRemoval = true;
 	continue;
       }
@@ -77,17 +98,17 @@ void PowerupSystem::spawnPowerup()
   Powerup p;
   p.landed = false;
 
-  p.targetPosition.x = Random::randomFloat(1000.f, 2000.f);
+  p.targetPosition.x = random.randomFloat(1000.f, 2000.f);
   p.targetPosition.y = terrain.getHeight(p.targetPosition.x);
 
   p.angle =
-    Random::randomFloat(-glm::quarter_pi<float>(), glm::quarter_pi<float>());
+    random.randomFloat(-glm::quarter_pi<float>(), glm::quarter_pi<float>());
 
   p.position = p.targetPosition;
   p.position.x += 2000.f * glm::sin(p.angle);
   p.position.y += 2000.f * glm::cos(p.angle);
   
-  p.type = Random::randomInt(0, Grenade::Type::_1 - 1);
+  p.type = random.randomInt(0, Grenade::Type::_1 - 1);
 
   powerups.push_back(p);
 }
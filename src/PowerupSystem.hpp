@@ -3,6 +3,8 @@
 #include <vector>
 
 #include "Powerup.hpp"
+#include "EventManager.hpp"
+#include "Random.hpp"
 
 class Terrain;
 class PlayerSystem;
@@ -10,6 +12,16 @@ class PlayerSystem;
 class PowerupSystem {
 public:
   PowerupSystem(const Terrain&, const PlayerSystem&);
+  ~PowerupSystem();
+
+  struct State {
+    std::vector<Powerup> powerups;
+    uint64_t randomCounter;
+  };
+
+  // Copies into s, reusing its storage
+  void saveState(State& s) const;
+  void restoreState(const State&);
 
   void update(double dt);
   const std::vector<Powerup>& getPowerups() const { return powerups; }
@@ -17,6 +29,12 @@ public:
 private:
   void spawnPowerup();
   std::vector<Powerup> powerups;
+  EventManager::Handle gameStartHandle;
+
+  // Scratch space for player broadphase queries
+  std::vector<int> nearbyPlayers;
+
+  RandomStream random;
 
   const Terrain& terrain;
   const PlayerSystem& playerSystem;
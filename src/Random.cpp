@@ -1,24 +1,35 @@
 #include "Random.hpp"
 
+#include <random>
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream) :
+  key(mix(seed ^ mix(stream + 0x632be59bd9b4e019ull))),
+  counter(0)
+{}
+
 // Initialize random generator
-std::mt19937 Random::generator = std::mt19937(std::random_device()());
+unsigned int Random::currentSeed = std::random_device()();
+RandomStream Random::generator = Random::stream(Random::GLOBAL);
+
+void Random::seed(unsigned int s)
+{
+  currentSeed = s;
+  generator = stream(GLOBAL);
+}
 
 double Random::randomDouble(double a, double b) {
-  std::uniform_real_distribution<double> distribution(a, b);
-  return distribution(generator);
+  return generator.randomDouble(a, b);
 }
 
 float Random::randomFloat()
 {
-  return randomFloat(0.f, 1.f);
+  return generator.randomFloat();
 }
 
 float Random::randomFloat(float a, float b) {
-  std::uniform_real_distribution<float> distribution(a, b);
-  return distribution(generator);
+  return generator.randomFloat(a, b);
 }
 
 int Random::randomInt(int a, int b) {
-  std::uniform_int_distribution<int> distribution(a, b);
-  return distribution(generator);
+  return generator.randomInt(a, b);
 }
@@ -1,16 +1,77 @@
 #pragma once
 
-#include <random>
+#include <cstdint>
+
+// Counter-based generator: the n-th number of a stream is a hash of its key
+// and n, so streams with different ids never overlap and the sequence
+// doesn't depend on the standard library's distributions.
+class RandomStream {
+public:
+  RandomStream(uint64_t seed, uint64_t stream);
+
+  uint64_t next()
+  {
+    return mix(key + (++counter) * 0x9e3779b97f4a7c15ull);
+  }
+
+  double randomDouble(double a, double b)
+  {
+    return a + (b - a) * ((next() >> 11) * 0x1.0p-53);
+  }
+
+  float randomFloat() { return (next() >> 40) * 0x1.0p-24f; }
+  float randomFloat(float a, float b) { return a + (b - a) * randomFloat(); }
+
+  // Inclusive of both ends
+  int randomInt(int a, int b)
+  {
+    uint64_t range = uint64_t(int64_t(b) - int64_t(a)) + 1;
+    return int(int64_t(a) + int64_t(((next() >> 32) * range) >> 32));
+  }
+
+  // Position in the stream, for saving and restoring
+  uint64_t getCounter() const { return counter; }
+  void setCounter(uint64_t c) { counter = c; }
+
+private:
+  static uint64_t mix(uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  uint64_t key;
+  uint64_t counter;
+};
 
 class Random {
 public:
   Random();
 
+  // Each system draws from its own stream, so e.g. camera shake doesn't
+  // shift the numbers gameplay sees
+  enum Stream : uint64_t {
+    GLOBAL,
+    TERRAIN,
+    GRENADES,
+    POWERUPS,
+    CAMERA,
+    BOTS
+  };
+
+  // Restart the sequence, the same seed gives the same numbers. Streams
+  // made afterwards derive from it.
+  static void seed(unsigned int);
+  static unsigned int getSeed() { return currentSeed; }
+  static RandomStream stream(Stream s) { return RandomStream(currentSeed, s); }
+
   static double randomDouble(double a, double b);
   static float randomFloat();
   static float randomFloat(float a, float b);
   static int randomInt(int a, int b);
 
 private:
-  static std::mt19937 generator;
+  static unsigned int currentSeed;
+  static RandomStream generator;
 };
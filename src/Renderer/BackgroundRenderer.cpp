@@ -2,17 +2,35 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include "../ResourceManager.hpp"
-#include "../Random.hpp"
+#include "../Snapshot.hpp"
 #include "../Terrain.hpp"
 
 #include "../Console.hpp"
 
-BackgroundRenderer::BackgroundRenderer(const Terrain* t) :
-  depth(100),
-  terrain(t)
+namespace {
+
+// Stable jitter in [0, 1) for a grid vertex
+float noise(uint32_t seed, int column, int row)
 {
+  uint32_t h = seed;
+  h ^= (uint32_t)column * 0x9e3779b1u;
+  h = (h ^ (h >> 16)) * 0x85ebca6bu;
+  h ^= (uint32_t)row * 0xc2b2ae35u;
+  h = (h ^ (h >> 13)) * 0x27d4eb2fu;
+  h ^= h >> 16;
+
+  return (h >> 8) * (1.f / 16777216.f);
+}
 
+}
+
+BackgroundRenderer::BackgroundRenderer(const Snapshot& s) :
+  depth(100),
+  width(s.terrainPoints.size()),
+  uploadedUpdateCount(s.terrainHistory.updateCount)
+{
   glGenBuffers(1, &VBO);
+  glGenBuffers(1, &EBO);
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -23,78 +41,139 @@ BackgroundRenderer::BackgroundRenderer(const Terrain* t) :
   glEnableVertexAttribArray(0);
   glEnableVertexAttribArray(1);
 
+  // Vertex data
+  verts.resize(width * depth);
+  for (int i = 0; i < width; ++i) {
+    buildColumn(i, s.terrainPoints[i]);
+  }
+  buildNormals(0, width);
+
+  glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(Vertex),
+      &verts[0], GL_DYNAMIC_DRAW);
+
+  // Index data, two triangles per grid cell
+  std::vector<unsigned int> indices;
+  for (int i = 0; i < width-1; ++i) {
+    for (int d = 0; d < depth-1; ++d) {
+      unsigned int a = i*depth + d;
+      unsigned int b = (i+1)*depth + d;
+      unsigned int c = (i+1)*depth + d+1;
+      unsigned int e = i*depth + d+1;
+
+      indices.insert(indices.end(), {a, b, c});
+      indices.insert(indices.end(), {e, a, c});
+    }
+  }
+  numIndices = indices.size();
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+      &indices[0], GL_STATIC_DRAW);
+
   glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
   shader = ResourceManager::GetShader("bg_mesh");
+  shader->use();
+  shader->setMat4("model", glm::mat4());
 }
 
-void BackgroundRenderer::draw()
+void BackgroundRenderer::buildColumn(int column, const glm::vec2& p)
 {
-  const std::vector<glm::vec2>& terrainPoints = terrain->getPoints();
-  int width = terrainPoints.size();
+  for (int d = 0; d < depth; ++d) {
+    glm::vec3 point {p.x, 0.f, -100.f-d*Terrain::PRECISION};
 
-  std::vector<glm::vec3> points;
+    if (d == 0) {
+      point.y = p.y;
+    }
+    else {
+      float modifier = d*0.06f;
+      if (modifier > 1.f) modifier = 1.f;
+      point.y = p.y + modifier * (-200.f - p.y);
+      point.y += 20.f*noise(NOISE_SEED, column, d);
+    }
 
-  for (int d = 0; d < depth; ++d) {
-    for (const auto& p : terrainPoints) {
-      glm::vec3 point {p.x, 0.f, -100.f-d*Terrain::PRECISION};
+    verts[column*depth + d].position = point;
+  }
+}
 
-      if (d == 0) {
-	point.y = p.y;
-      }
-      else {
-	float modifier = d*0.06f;
-	if (modifier > 1.f) modifier = 1.f;
-	point.y = p.y + modifier * (-200.f - p.y);
-	point.y += 20.f*Random::randomFloat();
-      }
-      
-      points.push_back(point);
+void BackgroundRenderer::buildNormals(int begin, int end)
+{
+  for (int i = begin; i < end; ++i) {
+    for (int d = 0; d < depth; ++d) {
+      verts[i*depth + d].normal = glm::vec3();
     }
   }
 
-  std::vector<glm::vec3> verts;
+  // Every face touching the columns, in cells from column begin-1
+  int firstCell = begin > 0 ? begin-1 : 0;
+  int lastCell = end < width-1 ? end : width-1;
 
-  // Generate verts
-  for (int d = 0; d < depth; ++d) {
-    for (int i = 0; i < width; ++i) {
-      if (i != width-1 && d != depth-1) {
-	glm::vec3 p1 = points[d*width+i];
-	glm::vec3 p2 = points[d*width+i+1];
-	glm::vec3 p3 = points[(d+1)*width+i+1];
-	glm::vec3 normal = glm::normalize(glm::cross(p1-p2, p3-p1));
-	verts.push_back(p1);
-	verts.push_back(normal);
-	verts.push_back(p2);
-	verts.push_back(normal);
-	verts.push_back(p3);
-	verts.push_back(normal);
-      }
-      if (i != width-1 && d != 0) {
-	glm::vec3 p1 = points[d*width+i];
-	glm::vec3 p2 = points[(d-1)*width+i];
-	glm::vec3 p3 = points[d*width+i+1];
-	glm::vec3 normal = glm::normalize(glm::cross(p1-p2, p3-p1));
-	verts.push_back(p1);
-	verts.push_back(normal);
-	verts.push_back(p2);
-	verts.push_back(normal);
-	verts.push_back(p3);
-	verts.push_back(normal);
-      }
+  auto addFace = [&](unsigned int v1, unsigned int v2, unsigned int v3) {
+    const glm::vec3& p1 = verts[v1].position;
+    const glm::vec3& p2 = verts[v2].position;
+    const glm::vec3& p3 = verts[v3].position;
+    glm::vec3 normal = glm::normalize(glm::cross(p1-p2, p3-p1));
+
+    for (unsigned int v : {v1, v2, v3}) {
+      int column = v / depth;
+      if (column >= begin && column < end) verts[v].normal += normal;
+    }
+  };
+
+  for (int i = firstCell; i < lastCell; ++i) {
+    for (int d = 0; d < depth-1; ++d) {
+      unsigned int a = i*depth + d;
+      unsigned int b = (i+1)*depth + d;
+      unsigned int c = (i+1)*depth + d+1;
+      unsigned int e = i*depth + d+1;
+
+      addFace(a, b, c);
+      addFace(e, a, c);
     }
   }
-  glBindVertexArray(VAO);
 
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(glm::vec3),
-      &verts[0], GL_STREAM_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  for (int i = begin; i < end; ++i) {
+    for (int d = 0; d < depth; ++d) {
+      glm::vec3& n = verts[i*depth + d].normal;
+      n = glm::normalize(n);
+    }
+  }
+}
 
-  glm::mat4 model;
-  shader.use();
-  shader.setMat4("model", model);
+void BackgroundRenderer::draw()
+{
+  const auto& points = snapshot->terrainPoints;
+
+  Terrain::RangeSet dirty =
+    snapshot->terrainHistory.since(uploadedUpdateCount, width);
+  uploadedUpdateCount = snapshot->terrainHistory.updateCount;
+
+  if (!dirty.empty()) {
+    for (const Terrain::Range& range : dirty) {
+      for (size_t i = range.begin; i < range.end; ++i) {
+	buildColumn(i, points[i]);
+      }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    for (const Terrain::Range& range : dirty) {
+      // Neighbouring columns share faces with the rebuilt ones
+      int begin = range.begin > 0 ? range.begin-1 : 0;
+      int end = (int)range.end < width ? range.end+1 : width;
+      buildNormals(begin, end);
+
+      glBufferSubData(GL_ARRAY_BUFFER,
+	  begin * depth * sizeof(Vertex),
+	  (end - begin) * depth * sizeof(Vertex),
+	  &verts[begin * depth]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  glBindVertexArray(VAO);
+  shader->use();
 
-  glDrawArrays(GL_TRIANGLES, 0, verts.size());
+  glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
   glBindVertexArray(0);
 }
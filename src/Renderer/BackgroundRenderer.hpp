@@ -1,21 +1,46 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
+#include <glm/vec3.hpp>
 #include "BaseRenderer.hpp"
 
-class Terrain;
+struct Snapshot;
 
+// Receding grid of hills behind the terrain, one column of depth vertices
+// per terrain point. Built once, then only the columns whose terrain
+// points changed are rebuilt and re-uploaded.
 class BackgroundRenderer : public BaseRenderer
 {
 public:
-  BackgroundRenderer(const Terrain*);
+  BackgroundRenderer(const Snapshot&);
   virtual void draw() override;
 private:
-  GLuint VAO;
-  GLuint VBO;
+  struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+  };
+
+  // Fixed so the jitter looks the same every run
+  static constexpr uint32_t NOISE_SEED = 0x5eed;
 
   int depth;
+  int width;
+
+  // Terrain update count of the last snapshot built from
+  unsigned long uploadedUpdateCount;
+
+  // Column major, vertex (column, row) is at column*depth + row
+  std::vector<Vertex> verts;
+  size_t numIndices;
+
+  void buildColumn(int column, const glm::vec2& terrainPoint);
+  // Recomputes normals of columns [begin, end) from the faces around them
+  void buildNormals(int begin, int end);
+
+  GLuint VAO;
+  GLuint VBO;
+  GLuint EBO;
 
-  Shader shader;
-  const Terrain* terrain;
+  const Shader* shader;
 };
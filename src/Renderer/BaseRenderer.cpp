@@ -5,6 +5,10 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/trigonometric.hpp>
 
+// Statics
+float BaseRenderer::alpha = 1.f;
+const Snapshot* BaseRenderer::snapshot = nullptr;
+
 // Defaults for shared VAO and VBO get overwritten later
 BaseRenderer::BaseRenderer()
 {
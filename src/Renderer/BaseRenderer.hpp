@@ -4,12 +4,21 @@
 #include "../Shader.hpp"
 #include "../Model.hpp"
 
+struct Snapshot;
+
 class BaseRenderer
 {
 public:
   BaseRenderer();
   virtual void draw() = 0;
+
+  // Blend factor between the previous and current logic tick
+  static void SetAlpha(float a) { alpha = a; }
+  // Tick to draw, must outlive the draw() calls
+  static void SetSnapshot(const Snapshot* s) { snapshot = s; }
 protected:
+  static float alpha;
+  static const Snapshot* snapshot;
 
 private:
 };
@@ -5,28 +5,31 @@
 #include <iostream>
 
 #include "../ResourceManager.hpp"
-#include "../GrenadeSystem.hpp"
+#include "../Snapshot.hpp"
 
-GrenadeRenderer::GrenadeRenderer(const GrenadeSystem& p) :
-  grenadeSystem(p)
+GrenadeRenderer::GrenadeRenderer() :
+  batch(ResourceManager::GetModel("quad"))
 {
-  shader = ResourceManager::GetShader("base");
-  grenadeModel = ResourceManager::GetModel("quad");
+  shader = ResourceManager::GetShader("instanced");
 }
 
 void GrenadeRenderer::draw()
 {
-  shader.use();
+  batch.clear();
 
-  for (auto& p : grenadeSystem.getGrenades()) {
-    if (p.dirty_awaitingRemoval) continue;
+  const auto& positions = snapshot->grenadePositions;
+  const auto& previousPositions = snapshot->grenadePreviousPositions;
+
+  for (size_t i = 0; i < positions.size(); ++i) {
+    glm::vec2 position = glm::mix(previousPositions[i], positions[i], alpha);
 
     glm::mat4 model = glm::mat4();
-    model = glm::translate(model, glm::vec3(p.position, 0.f));
+    model = glm::translate(model, glm::vec3(position, 0.f));
     model = glm::scale(model, glm::vec3(3.f, 3.f, 1.f));
 
-    shader.setMat4("model", model);
-
-    grenadeModel->draw();
+    batch.add(model);
   }
+
+  shader->use();
+  batch.draw();
 }
@@ -1,16 +1,14 @@
 #pragma once
 
 #include "BaseRenderer.hpp"
-
-class GrenadeSystem;
+#include "InstanceBatch.hpp"
 
 class GrenadeRenderer : public BaseRenderer {
 public:
-  GrenadeRenderer(const GrenadeSystem&);
+  GrenadeRenderer();
   virtual void draw() override;
 
 private:
-  const GrenadeSystem& grenadeSystem;
-  Shader shader;
-  const Model* grenadeModel;
+  const Shader* shader;
+  InstanceBatch batch;
 };
@@ -0,0 +1,59 @@
+#include "InstanceBatch.hpp"
+
+#include <cstddef>
+
+InstanceBatch::InstanceBatch(const Model* m) :
+  model(m)
+{
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &instanceVBO);
+
+  glBindVertexArray(VAO);
+
+  // Shared model geometry
+  glBindBuffer(GL_ARRAY_BUFFER, model->getVBO());
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->getEBO());
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GL_FLOAT), (void*)0);
+  glEnableVertexAttribArray(0);
+
+  // Per instance model matrix, one attribute per column, then color
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  for (int i = 0; i < 4; ++i) {
+    glVertexAttribPointer(1+i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+	(void*)(offsetof(Instance, model) + i * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(1+i);
+    glVertexAttribDivisor(1+i, 1);
+  }
+
+  glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+      (void*)offsetof(Instance, color));
+  glEnableVertexAttribArray(5);
+  glVertexAttribDivisor(5, 1);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatch::add(const glm::mat4& m, glm::vec4 color)
+{
+  instances.push_back({m, color});
+}
+
+void InstanceBatch::draw()
+{
+  if (instances.empty()) return;
+
+  // Orphan last frame's storage rather than wait for the GPU to finish
+  // reading it, then fill the fresh one
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance),
+      NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(Instance),
+      &instances[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glBindVertexArray(VAO);
+  glDrawElementsInstanced(GL_TRIANGLES, model->indices.size(),
+      GL_UNSIGNED_INT, 0, instances.size());
+  glBindVertexArray(0);
+}
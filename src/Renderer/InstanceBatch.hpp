@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "../Model.hpp"
+
+// Draws many copies of one model in a single instanced draw call.
+//
+// Instances are collected each frame with add(), then streamed into an
+// instance buffer and drawn together by draw(). Meant for the "instanced"
+// shader, which takes the per-instance model matrix and color as vertex
+// attributes instead of uniforms.
+class InstanceBatch
+{
+public:
+  InstanceBatch(const Model*);
+
+  InstanceBatch(const InstanceBatch&) = delete;
+  InstanceBatch& operator=(const InstanceBatch&) = delete;
+
+  struct Instance {
+    glm::mat4 model;
+    glm::vec4 color;
+  };
+
+  void clear() { instances.clear(); }
+  void add(const glm::mat4& model, glm::vec4 color = glm::vec4(1.f));
+  size_t size() const { return instances.size(); }
+
+  // Uploads and draws everything added since the last clear().
+  // Expects the shader to already be in use.
+  void draw();
+
+private:
+  const Model* model;
+  std::vector<Instance> instances;
+
+  GLuint VAO;
+  GLuint instanceVBO;
+};
@@ -5,41 +5,48 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "../ResourceManager.hpp"
+#include "../geo.hpp"
 #include "../Player.hpp"
-#include "../PlayerSystem.hpp"
+#include "../Snapshot.hpp"
 
-PlayerRenderer::PlayerRenderer(const PlayerSystem& p) :
-  playerSystem(p)
+PlayerRenderer::PlayerRenderer() :
+  batch(ResourceManager::GetModel("quad"))
 {
-  shader = ResourceManager::GetShader("base");
-  playerModel = ResourceManager::GetModel("quad");
+  shader = ResourceManager::GetShader("instanced");
 }
 
 void PlayerRenderer::draw()
 {
-  shader.use();
-  
-  for (const auto p : playerSystem.getPlayers()) {
+  batch.clear();
+
+  for (const auto& p : snapshot->players) {
+    glm::vec2 position = glm::mix(p.previousPosition, p.position, alpha);
+    float angle = glm::mix(p.previousAngle, p.angle, alpha);
+    float aimDirection =
+      geo::mixAngle(p.previousAimDirection, p.aimDirection, alpha);
+
     glm::mat4 model = glm::mat4();
     // Move to player position
-    model = glm::translate(model, glm::vec3(p.position, 0.f));
+    model = glm::translate(model, glm::vec3(position, 0.f));
     // Rotate to player angle
-    model = glm::rotate(model, p.angle, glm::vec3(0.f, 0.f, 1.f));
+    model = glm::rotate(model, angle, glm::vec3(0.f, 0.f, 1.f));
     // Size to player
     model = glm::scale(model, glm::vec3(Player::SIZE, Player::SIZE, 1.f));
     // Move origin to bottom middle
     model = glm::translate(model, glm::vec3({0.f, 1.f, 0.f}));
-    shader.setMat4("model", model);
 
-    // draw
-    playerModel->draw();
+    batch.add(model);
 
     // Draw aim direction
+    glm::vec2 centerPosition = position +
+      Player::SIZE * glm::vec2(-glm::sin(angle), glm::cos(angle));
+
     model = glm::mat4();
-    model = glm::translate(model, {p.getCenterPosition(), 0.f});
-    model = glm::rotate(model, -p.aimDirection, {0.f, 0.f, 1.f});
+    model = glm::translate(model, {centerPosition, 0.f});
+    model = glm::rotate(model, -aimDirection, {0.f, 0.f, 1.f});
     model = glm::scale(model, {2*Player::SIZE, 1.f, 1.f});
-    shader.setMat4("model", model);
-
   }
+
+  shader->use();
+  batch.draw();
 }
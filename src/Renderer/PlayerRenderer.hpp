@@ -3,17 +3,16 @@
 #include <vector>
 
 #include "BaseRenderer.hpp"
+#include "InstanceBatch.hpp"
 
-class PlayerSystem;
 struct Player;
 
 class PlayerRenderer : public BaseRenderer
 {
 public:
-  PlayerRenderer(const PlayerSystem&);
+  PlayerRenderer();
   virtual void draw() override;
 private:
-  const PlayerSystem& playerSystem;
-  Shader shader;
-  const Model* playerModel;
+  const Shader* shader;
+  InstanceBatch batch;
 };
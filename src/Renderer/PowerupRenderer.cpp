@@ -4,26 +4,27 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "../ResourceManager.hpp"
-#include "../PowerupSystem.hpp"
+#include "../Snapshot.hpp"
 
-PowerupRenderer::PowerupRenderer(const PowerupSystem& p) :
-  powerupSystem(p)
+PowerupRenderer::PowerupRenderer() :
+  batch(ResourceManager::GetModel("quad"))
 {
-  shader = ResourceManager::GetShader("base");
-  powerupModel = ResourceManager::GetModel("quad");
+  shader = ResourceManager::GetShader("instanced");
 }
 
 void PowerupRenderer::draw()
 {
-  shader.use();
+  batch.clear();
 
-  for (auto p : powerupSystem.getPowerups()) {
+  for (const auto& p : snapshot->powerups) {
     glm::mat4 model = glm::mat4();
     model = glm::translate(model, glm::vec3(p.position, 0.f));
     model = glm::scale(model, glm::vec3(6.f, 6.f, 1.f));
     model = glm::translate(model, glm::vec3({0.f, 1.f, 0.f}));
 
-    shader.setMat4("model", model);
-    powerupModel->draw();
+    batch.add(model);
   }
+
+  shader->use();
+  batch.draw();
 }
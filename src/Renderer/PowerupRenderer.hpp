@@ -1,16 +1,14 @@
 #pragma once
 
 #include "BaseRenderer.hpp"
-
-class PowerupSystem;
+#include "InstanceBatch.hpp"
 
 class PowerupRenderer : public BaseRenderer {
 public:
-  PowerupRenderer(const PowerupSystem&);
+  PowerupRenderer();
   virtual void draw() override;
 
 private:
-  const PowerupSystem& powerupSystem;
-  Shader shader;
-  const Model* powerupModel;
+  const Shader* shader;
+  InstanceBatch batch;
 };
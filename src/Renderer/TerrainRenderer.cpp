@@ -4,17 +4,18 @@
 #include <glm/vec3.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/constants.hpp>
-#include <GLFW/glfw3.h>
 
-#include "../Terrain.hpp"
+#include "../Snapshot.hpp"
 #include "../ResourceManager.hpp"
 #include "../Random.hpp"
 
 #include <iostream>
+#include <cstddef>
 
-TerrainRenderer::TerrainRenderer(const Terrain& t) :
-  terrain(t),
-  depth(10000.f)
+TerrainRenderer::TerrainRenderer(const Snapshot& s, bool g) :
+  depth(10000.f),
+  gpuWobble(g),
+  currentRegion(0)
 {
   glGenBuffers(1, &VBO);
   glGenBuffers(1, &EBO);
@@ -28,8 +29,29 @@ TerrainRenderer::TerrainRenderer(const Terrain& t) :
 
   glEnableVertexAttribArray(0);
 
-  // Index data
-  const auto& points = terrain.getPoints();
+  // Vertex data
+  std::vector<glm::vec3> verts;
+  const auto& points = getPoints(s);
+  for (size_t i = 0; i < points.size(); ++i) {
+    const glm::vec2& p1 = points[i];
+    verts.push_back({p1.x, p1.y, 0.f});
+    verts.push_back({p1.x, -depth, 0.f});
+  }
+  regionVerts = verts.size();
+
+  // Allocate every copy once and fill them all, draw() then only
+  // rewrites points the snapshots report dirty
+  size_t regionSize = regionVerts * sizeof(glm::vec3);
+  glBufferData(GL_ARRAY_BUFFER, RING_SIZE * regionSize, NULL, GL_STREAM_DRAW);
+
+  for (int r = 0; r < RING_SIZE; ++r) {
+    glBufferSubData(GL_ARRAY_BUFFER, r * regionSize, regionSize, &verts[0]);
+    regions[r] = {getHistory(s).updateCount, 0, false};
+  }
+
+  // Index data, never changes so it's uploaded here and kept in the VAO.
+  // Indices are relative to a region, draw() offsets them with a base vertex.
+  std::vector<unsigned int> indices;
   for (size_t i = 0; i < points.size()-1; ++i) {
     indices.push_back(2*i);
     indices.push_back(2*i+1);
@@ -39,45 +61,151 @@ TerrainRenderer::TerrainRenderer(const Terrain& t) :
     indices.push_back(2*(i+1)+1);
     indices.push_back(2*(i+1));
   }
+  numIndices = indices.size();
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+      &indices[0], GL_STATIC_DRAW);
 
   glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  shader = ResourceManager::GetShader("terrain");
+  // Terrain is already in world space
+  shader = ResourceManager::GetShader(gpuWobble ? "terrain_wobble" : "terrain");
+  shader->use();
+  shader->setMat4("model", glm::mat4());
 }
 
 void TerrainRenderer::draw()
 {
+  const auto& points = getPoints(*snapshot);
+  const auto& history = getHistory(*snapshot);
+
+  currentRegion = (currentRegion + 1) % RING_SIZE;
+  Region& region = regions[currentRegion];
+
+  // Bring this copy up to date with every point changed since it was
+  // last written, which may be several snapshots back
+  Terrain::RangeSet dirty;
+  if (region.lost) dirty.add({0, points.size()});
+  else dirty = history.since(region.uploadedUpdateCount, points.size());
+
+  if (!dirty.empty()) {
+    // Normally long signalled, RING_SIZE frames have passed since. If it
+    // isn't, an unsynchronised write could change vertices still being
+    // drawn, so leave the synchronising to glBufferSubData instead.
+    bool idle = true;
+    if (region.fence) {
+      GLenum wait = glClientWaitSync(region.fence,
+	  GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      idle = (wait == GL_ALREADY_SIGNALED || wait == GL_CONDITION_SATISFIED);
+      glDeleteSync(region.fence);
+      region.fence = 0;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    bool lost = false;
+
+    for (const Terrain::Range& range : dirty) {
+      glm::vec3* verts = nullptr;
+      if (idle) {
+	size_t first = currentRegion * regionVerts + 2 * range.begin;
+	size_t count = 2 * (range.end - range.begin);
+
+	// Already fenced, so no need for GL to synchronise the mapping
+	verts = (glm::vec3*)glMapBufferRange(GL_ARRAY_BUFFER,
+	    first * sizeof(glm::vec3), count * sizeof(glm::vec3),
+	    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+	    GL_MAP_UNSYNCHRONIZED_BIT);
+      }
+
+      if (!verts) {
+	bufferVertices(points, range);
+	continue;
+      }
+
+      writeVertices(points, range, verts);
+      if (!glUnmapBuffer(GL_ARRAY_BUFFER)) {
+	// The whole buffer's contents are undefined now, not just this range
+	lost = true;
+	break;
+      }
+    }
+
+    if (lost) {
+      for (Region& r : regions) r.lost = true;
+      bufferVertices(points, {0, points.size()});
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // Only now is this copy known to hold every point
+  region.lost = false;
+  region.uploadedUpdateCount = history.updateCount;
+
+  if (gpuWobble) {
+    const auto& wobbles = snapshot->terrainWobbles;
+
+    // Oldest are dropped if there's no room, same as Terrain::wobble
+    size_t count = wobbles.size();
+    size_t first = 0;
+    if (count > WobblesBlock::MAX_WOBBLES) {
+      first = count - WobblesBlock::MAX_WOBBLES;
+      count = WobblesBlock::MAX_WOBBLES;
+    }
+
+    wobbleBlock.count = count;
+    for (size_t i = 0; i < count; ++i) {
+      const auto& w = wobbles[first + i];
+      wobbleBlock.wobbles[i] = {w.origin, w.scale, w.reach, 0.f};
+    }
+
+    wobbleBuffer.upload(wobbleBlock,
+	offsetof(WobblesBlock, wobbles) + count * sizeof(glm::vec4));
+  }
+
   glBindVertexArray(VAO);
-  shader.use();
-  shader.setFloat("time", glfwGetTime());
+  shader->use();
 
-  const auto& points = terrain.getPoints();
+  // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+  glDrawElementsBaseVertex(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0,
+      currentRegion * regionVerts);
+  // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glBindVertexArray(0);
 
-  verts.clear();
-  normals.clear();
+  if (region.fence) glDeleteSync(region.fence);
+  region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
 
-  // Vertex data
-  for (size_t i = 0; i < points.size(); ++i) {
+void TerrainRenderer::writeVertices(const std::vector<glm::vec2>& points,
+    Terrain::Range range, glm::vec3* verts) const
+{
+  for (size_t i = range.begin; i < range.end; ++i) {
     const glm::vec2& p1 = points[i];
-    verts.push_back({p1.x, p1.y, 0.f});
-    verts.push_back({p1.x, -depth, 0.f}); 
+    *verts++ = {p1.x, p1.y, 0.f};
+    *verts++ = {p1.x, -depth, 0.f};
   }
+}
 
-  glBindVertexArray(VAO);
-
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(glm::vec3),
-      &verts[0], GL_STREAM_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+void TerrainRenderer::bufferVertices(const std::vector<glm::vec2>& points,
+    Terrain::Range range)
+{
+  size_t first = currentRegion * regionVerts + 2 * range.begin;
+  stagingVerts.resize(2 * (range.end - range.begin));
+  writeVertices(points, range, stagingVerts.data());
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-      &indices[0], GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec3),
+      stagingVerts.size() * sizeof(glm::vec3), stagingVerts.data());
+}
 
-  shader.setMat4("model", glm::mat4());
+const std::vector<glm::vec2>& TerrainRenderer::getPoints(
+    const Snapshot& s) const
+{
+  return gpuWobble ? s.terrainBasePoints : s.terrainPoints;
+}
 
-  // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-  // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  glBindVertexArray(0);
+const Terrain::DirtyHistory& TerrainRenderer::getHistory(
+    const Snapshot& s) const
+{
+  return gpuWobble ? s.terrainBaseHistory : s.terrainHistory;
 }
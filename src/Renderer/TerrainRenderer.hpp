@@ -2,25 +2,65 @@
 
 #include <vector>
 #include "BaseRenderer.hpp"
+#include "../Terrain.hpp"
+#include "../UniformBlocks.hpp"
+#include "../UniformBuffer.hpp"
 
-class Terrain;
+struct Snapshot;
 
 class TerrainRenderer : public BaseRenderer
 {
 public:
-  TerrainRenderer(const Terrain&);
+  // Sizes the buffers from a first snapshot. With gpuWobble the vertex
+  // buffer holds base points and the vertex shader adds wobbles, so
+  // wobbling alone needs no vertex upload.
+  TerrainRenderer(const Snapshot&, bool gpuWobble = false);
   virtual void draw() override;
 private:
-  const Terrain& terrain;
   float depth;
+  bool gpuWobble;
+
+  // Points the vertex buffer holds, and their dirty history
+  const std::vector<glm::vec2>& getPoints(const Snapshot&) const;
+  const Terrain::DirtyHistory& getHistory(const Snapshot&) const;
+
+  // The vertex buffer holds this many full copies of the terrain. Each
+  // frame draws from the next one, so the CPU writes a copy the GPU
+  // finished with frames ago instead of one it may still be reading.
+  static constexpr int RING_SIZE = 3;
+
+  struct Region {
+    // Terrain update count of the last snapshot written to this copy
+    unsigned long uploadedUpdateCount;
+    // Signalled once the GPU is done with the last draw from this copy
+    GLsync fence;
+    // GL lost the buffer contents while it was mapped, rewrite every point
+    bool lost;
+  };
+
+  Region regions[RING_SIZE];
+  int currentRegion;
+  // Vertices in one copy of the terrain
+  size_t regionVerts;
+
+  // Writes the two vertices of each point in range to verts
+  void writeVertices(const std::vector<glm::vec2>& points,
+      Terrain::Range range, glm::vec3* verts) const;
+  // Writes range into the current copy through glBufferSubData, for
+  // when it can't be mapped. VBO must be bound.
+  void bufferVertices(const std::vector<glm::vec2>& points,
+      Terrain::Range range);
+  std::vector<glm::vec3> stagingVerts;
 
   GLuint VAO;
   GLuint VBO;
   GLuint EBO;
 
-  std::vector<glm::vec3> verts;
   std::vector<glm::vec3> normals;
-  std::vector<unsigned int> indices;
+  size_t numIndices;
+
+  const Shader* shader;
 
-  Shader shader;
+  WobblesBlock wobbleBlock;
+  UniformBuffer<WobblesBlock> wobbleBuffer;
 };
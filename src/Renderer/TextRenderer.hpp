@@ -8,6 +8,6 @@ public:
   TextRenderer();
   virtual void draw() override;
 private:
-  Shader shader;
+  const Shader* shader;
   const Model* model;
 };
@@ -1,28 +1,32 @@
 #include "TimescaleZoneRenderer.hpp"
 
 #include "../ResourceManager.hpp"
-#include "../TimescaleSystem.hpp"
+#include "../Snapshot.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
-TimescaleZoneRenderer::TimescaleZoneRenderer(const TimescaleSystem& t) :
-  timescaleSystem(t)
+namespace {
+const glm::vec4 zoneColor(0.f, 0.7f, 1.f, 0.2f);
+}
+
+TimescaleZoneRenderer::TimescaleZoneRenderer() :
+  batch(ResourceManager::GetModel("circle"))
 {
-  shader = ResourceManager::GetShader("inertia_zone");
-  zoneModel = ResourceManager::GetModel("circle");
+  shader = ResourceManager::GetShader("instanced");
 }
 
 void TimescaleZoneRenderer::draw()
 {
-  shader.use();
+  batch.clear();
 
-  for (auto& z : timescaleSystem.getZones()) {
+  for (auto& z : snapshot->zones) {
     glm::mat4 model = glm::mat4();
     model = glm::translate(model, glm::vec3(z.position, 0.f));
     model = glm::scale(model, {z.radius, z.radius, 1.f});
 
-    shader.setMat4("model", model);
-
-    zoneModel->draw();
+    batch.add(model, zoneColor);
   }
+
+  shader->use();
+  batch.draw();
 }
@@ -1,16 +1,14 @@
 #pragma once
 
 #include "BaseRenderer.hpp"
-
-class TimescaleSystem;
+#include "InstanceBatch.hpp"
 
 class TimescaleZoneRenderer : public BaseRenderer {
 public:
-  TimescaleZoneRenderer(const TimescaleSystem&);
+  TimescaleZoneRenderer();
   virtual void draw() override;
 
 private:
-  const TimescaleSystem& timescaleSystem;
-  Shader shader;
-  const Model* zoneModel;
+  const Shader* shader;
+  InstanceBatch batch;
 };
@@ -0,0 +1,187 @@
+#include "Replay.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[4] = {'G', 'R', 'R', 'P'};
+const uint32_t VERSION = 1;
+
+enum RecordKind : uint8_t {
+  BUTTON = 0,
+  AXES = 1,
+  END = 2,
+};
+
+template <typename T>
+void writeValue(std::ofstream& file, T value)
+{
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readValue(std::ifstream& file)
+{
+  T value{};
+  file.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return value;
+}
+
+}
+
+ReplayRecorder::ReplayRecorder(const std::string& path, unsigned int seed,
+    double tickLength, const std::map<int, ControllerData>& controllers)
+{
+  file.open(path, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "Error: Couldn't open replay " << path << std::endl;
+    return;
+  }
+
+  file.write(MAGIC, sizeof(MAGIC));
+  writeValue<uint32_t>(file, VERSION);
+  writeValue<uint32_t>(file, seed);
+  writeValue<double>(file, tickLength);
+
+  writeValue<uint32_t>(file, controllers.size());
+  for (const auto& c : controllers) {
+    const std::vector<float>& axes = c.second.axes;
+
+    writeValue<int32_t>(file, c.first);
+    writeValue<uint8_t>(file, axes.size());
+    file.write(reinterpret_cast<const char*>(axes.data()),
+	axes.size() * sizeof(float));
+
+    lastAxes[c.first] = axes;
+  }
+}
+
+void ReplayRecorder::record(unsigned long tick, const InputFrame& frame)
+{
+  if (!file.is_open()) return;
+
+  for (const auto& b : frame.buttons) {
+    writeValue<uint32_t>(file, tick);
+    writeValue<uint8_t>(file, BUTTON);
+    writeValue<int32_t>(file, b.controllerID);
+    writeValue<int32_t>(file, b.button);
+    writeValue<uint8_t>(file, b.action);
+  }
+
+  for (const auto& a : frame.axes) {
+    std::vector<float>& last = lastAxes[a.first];
+    if (a.second == last) continue;
+    last = a.second;
+
+    writeValue<uint32_t>(file, tick);
+    writeValue<uint8_t>(file, AXES);
+    writeValue<int32_t>(file, a.first);
+    writeValue<uint8_t>(file, a.second.size());
+    file.write(reinterpret_cast<const char*>(a.second.data()),
+	a.second.size() * sizeof(float));
+  }
+}
+
+void ReplayRecorder::finish(unsigned long numTicks)
+{
+  if (!file.is_open()) return;
+
+  writeValue<uint32_t>(file, numTicks);
+  writeValue<uint8_t>(file, END);
+  file.close();
+}
+
+ReplayPlayer::ReplayPlayer(const std::string& path) :
+  open(false),
+  seed(0),
+  tickLength(0.0),
+  nextTick(NONE),
+  endTick(NONE)
+{
+  file.open(path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "Error: Couldn't open replay " << path << std::endl;
+    return;
+  }
+
+  char magic[4];
+  file.read(magic, sizeof(magic));
+  uint32_t version = readValue<uint32_t>(file);
+
+  if (!file.good() || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      version != VERSION) {
+    std::cout << "Error: " << path << " is not a replay" << std::endl;
+    return;
+  }
+
+  seed = readValue<uint32_t>(file);
+  tickLength = readValue<double>(file);
+
+  uint32_t numControllers = readValue<uint32_t>(file);
+  for (uint32_t i = 0; i < numControllers && file.good(); ++i) {
+    std::vector<float>& axes = controllers[readValue<int32_t>(file)].axes;
+    axes.resize(readValue<uint8_t>(file));
+    file.read(reinterpret_cast<char*>(axes.data()),
+	axes.size() * sizeof(float));
+  }
+
+  if (!file.good()) {
+    std::cout << "Error: Truncated replay " << path << std::endl;
+    return;
+  }
+
+  open = true;
+  readTick();
+}
+
+void ReplayPlayer::readTick()
+{
+  uint32_t tick = readValue<uint32_t>(file);
+  nextTick = file.good() ? tick : NONE;
+}
+
+bool ReplayPlayer::read(unsigned long tick, InputFrame& frame)
+{
+  frame.clear();
+
+  while (nextTick <= tick) {
+    uint8_t kind = readValue<uint8_t>(file);
+
+    if (kind == END) {
+      endTick = nextTick;
+      nextTick = NONE;
+      break;
+    }
+
+    int32_t controllerID = readValue<int32_t>(file);
+    bool known = controllers.count(controllerID) > 0;
+
+    if (kind == BUTTON && known) {
+      int32_t button = readValue<int32_t>(file);
+      uint8_t action = readValue<uint8_t>(file);
+      frame.buttons.push_back({controllerID, button, action != 0});
+    }
+    else if (kind == AXES && known) {
+      std::vector<float>& axes = frame.axes[controllerID];
+      axes.resize(readValue<uint8_t>(file));
+      file.read(reinterpret_cast<char*>(axes.data()),
+	  axes.size() * sizeof(float));
+    }
+    else {
+      // Unknown kind, or a controller the header doesn't list
+      std::cout << "Error: Corrupt replay record" << std::endl;
+      nextTick = NONE;
+      endTick = tick;
+      break;
+    }
+
+    readTick();
+  }
+
+  // Unfinished replays end with their input
+  if (nextTick == NONE && endTick == NONE) endTick = tick + 1;
+
+  return tick < endTick;
+}
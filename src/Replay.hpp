@@ -0,0 +1,80 @@
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ControllerData.hpp"
+#include "InputFrame.hpp"
+
+// Replays are a match's Random seed and tick length, followed by the input
+// that changed on each tick. Fed back into a fresh Simulation seeded the
+// same way, they reproduce the match tick for tick.
+//
+// File format, host byte order:
+//   char[4]  "GRRP"
+//   uint32   version
+//   uint32   seed
+//   float64  tick length
+//   uint32   controller count, then per controller:
+//              int32 id, uint8 axis count, float32 axes[count]
+//   records until end of file, each applying before the given tick:
+//     uint32 tick, uint8 kind
+//     BUTTON: int32 controller, int32 button, uint8 action
+//     AXES:   int32 controller, uint8 count, float32 axes[count]
+//     END:    nothing, the match stopped before this tick
+
+class ReplayRecorder
+{
+public:
+  ReplayRecorder(const std::string& path, unsigned int seed,
+      double tickLength, const std::map<int, ControllerData>&);
+
+  bool isOpen() const { return file.is_open(); }
+
+  // Input applied before tick. Axes are only written when they differ
+  // from the last ones written for that controller.
+  void record(unsigned long tick, const InputFrame&);
+  // Marks the end of the match, after the last tick run
+  void finish(unsigned long numTicks);
+
+private:
+  std::ofstream file;
+  std::map<int, std::vector<float>> lastAxes;
+};
+
+class ReplayPlayer
+{
+public:
+  ReplayPlayer(const std::string& path);
+
+  // False if the file couldn't be read or isn't a replay
+  bool isOpen() const { return open; }
+
+  unsigned int getSeed() const { return seed; }
+  double getTickLength() const { return tickLength; }
+  // Controllers as they were at the start of the match
+  const std::map<int, ControllerData>& getControllers() const
+  { return controllers; }
+
+  // Replaces frame with the input recorded for tick. Ticks must be asked
+  // for in increasing order. Returns false once the match is over, or the
+  // input has run out in a replay that was never finished.
+  bool read(unsigned long tick, InputFrame& frame);
+
+private:
+  static constexpr unsigned long NONE = ~0ul;
+
+  std::ifstream file;
+  bool open;
+
+  unsigned int seed;
+  double tickLength;
+  std::map<int, ControllerData> controllers;
+
+  // Tick of the next unread record, read ahead
+  unsigned long nextTick;
+  unsigned long endTick;
+  void readTick();
+};
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "Console.hpp"
+#include "UniformBlocks.hpp"
 
 // Initialize statics
 std::map<std::string, Shader> ResourceManager::shaders;
@@ -50,14 +51,13 @@ void ResourceManager::LoadShader(const std::string& name,
   const char* vertexCode_cstr = vertexCode.c_str();
   const char* fragmentCode_cstr = fragmentCode.c_str();
 
-  Shader shader;
+  Shader& shader = shaders[name];
   shader.compile(vertexCode_cstr, fragmentCode_cstr);
 
   // Set UBO bindings
-  unsigned int uboIndex = glGetUniformBlockIndex(shader.ID, "Matrices");
-  glUniformBlockBinding(shader.ID, uboIndex, 0);
-
-  shaders[name] = shader;
+  shader.bindUniformBlock(MatricesBlock::NAME, MatricesBlock::BINDING);
+  shader.bindUniformBlock(FrameBlock::NAME, FrameBlock::BINDING);
+  shader.bindUniformBlock(WobblesBlock::NAME, WobblesBlock::BINDING);
 }
 
 void ResourceManager::LoadModel(const std::string& name,
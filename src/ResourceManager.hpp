@@ -14,7 +14,7 @@ public:
   static void LoadShader(const std::string& name,
       const std::string& vertexShaderFile,
       const std::string& fragmentShaderFile);
-  static Shader GetShader(std::string name) { return shaders[name]; }
+  static const Shader* GetShader(std::string name) { return &shaders[name]; }
 
   static void LoadModel(const std::string& name,
       const std::string& filename);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+// Raw binary reads and writes of plain data, in host byte order. Only
+// meant for types that are safe to memcpy. Reads return false once the
+// stream runs out.
+namespace serialize
+{
+  template <typename T>
+    void writeValue(std::ostream&, const T&);
+  template <typename T>
+    bool readValue(std::istream&, T&);
+
+  // Element count as uint32, then the elements
+  template <typename T>
+    void writeVector(std::ostream&, const std::vector<T>&);
+  template <typename T>
+    bool readVector(std::istream&, std::vector<T>&);
+}
+
+// IMPL
+template <typename T>
+void serialize::writeValue(std::ostream& out, const T& value)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+      "Only plain data can be written raw");
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool serialize::readValue(std::istream& in, T& value)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+      "Only plain data can be read raw");
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return bool(in);
+}
+
+template <typename T>
+void serialize::writeVector(std::ostream& out, const std::vector<T>& v)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+      "Only plain data can be written raw");
+  writeValue<uint32_t>(out, v.size());
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+bool serialize::readVector(std::istream& in, std::vector<T>& v)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+      "Only plain data can be read raw");
+  uint32_t size;
+  if (!readValue(in, size)) return false;
+
+  v.resize(size);
+  in.read(reinterpret_cast<char*>(v.data()), size * sizeof(T));
+  return bool(in);
+}
@@ -51,9 +51,30 @@ void Shader::compile(const char* vertexCode, const char* fragmentCode)
   // so are no longer needed.
   glDeleteShader(vertex);
   glDeleteShader(fragment);
-  
-  // The Shader is only a wrapper around the program's
-  // numeric ID now.
+
+  // Cache uniform locations so nothing has to ask GL by name later
+  uniformLocations.clear();
+
+  int numUniforms = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &numUniforms);
+
+  for (int i = 0; i < numUniforms; ++i) {
+    char name[256];
+    GLsizei length;
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(ID, i, sizeof(name), &length, &size, &type, name);
+
+    // Block members have no location of their own
+    GLint location = glGetUniformLocation(ID, name);
+    if (location < 0) continue;
+
+    // Arrays are reported as "name[0]", also store them as "name"
+    std::string n(name, length);
+    uniformLocations[n] = location;
+    if (n.size() > 3 && n.compare(n.size()-3, 3, "[0]") == 0)
+      uniformLocations[n.substr(0, n.size()-3)] = location;
+  }
 }
 
 void Shader::use() const
@@ -61,25 +82,60 @@ void Shader::use() const
   glUseProgram(ID);
 }
 
+void Shader::bindUniformBlock(const char* name, unsigned int binding) const
+{
+  unsigned int index = glGetUniformBlockIndex(ID, name);
+  if (index == GL_INVALID_INDEX) return;
+
+  glUniformBlockBinding(ID, index, binding);
+}
+
+GLint Shader::getLocation(const std::string& name) const
+{
+  auto it = uniformLocations.find(name);
+  if (it == uniformLocations.end()) return -1;
+
+  return it->second;
+}
+
+void Shader::set(Uniform<bool> u, bool value) const
+{
+  glUniform1i(u.location, (int)value);
+}
+void Shader::set(Uniform<int> u, int value) const
+{
+  glUniform1i(u.location, value);
+}
+void Shader::set(Uniform<float> u, float value) const
+{
+  glUniform1f(u.location, value);
+}
+void Shader::set(Uniform<glm::vec2> u, glm::vec2 value) const
+{
+  glUniform2fv(u.location, 1, glm::value_ptr(value));
+}
+void Shader::set(Uniform<glm::mat4> u, const glm::mat4& value) const
+{
+  glUniformMatrix4fv(u.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
 void Shader::setBool(const std::string &name, bool value) const
-{         
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+{
+  set(getUniform<bool>(name), value);
 }
 void Shader::setInt(const std::string &name, int value) const
-{ 
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+{
+  set(getUniform<int>(name), value);
 }
 void Shader::setFloat(const std::string &name, float value) const
-{ 
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
-} 
+{
+  set(getUniform<float>(name), value);
+}
 void Shader::setVec2(const std::string& name, glm::vec2 value) const
 {
-  glUniform2fv(glGetUniformLocation(ID, name.c_str()),
-      1, glm::value_ptr(value));
+  set(getUniform<glm::vec2>(name), value);
 }
 void Shader::setMat4(const std::string& name, glm::mat4 value) const
 {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()),
-      1, GL_FALSE, glm::value_ptr(value));
+  set(getUniform<glm::mat4>(name), value);
 }
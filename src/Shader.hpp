@@ -2,6 +2,8 @@
 
 #include <glad/glad.h>
 #include <string>
+#include <map>
+#include <glm/vec2.hpp>
 #include <glm/mat4x4.hpp>
 
 class Shader
@@ -9,13 +11,47 @@ class Shader
 public:
   unsigned int ID;
 
+  // Uniform location looked up once, typed so a handle can only be set
+  // with the kind of value it was fetched for. Setting a handle to a
+  // uniform the shader doesn't have (location -1) is a no-op.
+  template <typename T>
+  struct Uniform {
+    GLint location = -1;
+  };
+
   Shader();
   void compile(const char* vertexCode, const char* fragCode);
   void use() const;
 
+  // Binds the named uniform block to a buffer binding point,
+  // if the shader uses it
+  void bindUniformBlock(const char* name, unsigned int binding) const;
+
+  template <typename T>
+  Uniform<T> getUniform(const std::string& name) const;
+
+  void set(Uniform<bool>, bool value) const;
+  void set(Uniform<int>, int value) const;
+  void set(Uniform<float>, float value) const;
+  void set(Uniform<glm::vec2>, glm::vec2 value) const;
+  void set(Uniform<glm::mat4>, const glm::mat4& value) const;
+
+  // By name, for one-off setup. Per-frame code should hold a Uniform.
   void setBool(const std::string &name, bool value) const;
   void setInt(const std::string &name, int value) const;
   void setFloat(const std::string &name, float value) const;
   void setVec2(const std::string &name, glm::vec2 value) const;
   void setMat4(const std::string &name, glm::mat4 value) const;
+
+private:
+  // Every active uniform, reflected after linking
+  std::map<std::string, GLint> uniformLocations;
+  GLint getLocation(const std::string& name) const;
 };
+
+// IMPL
+template <typename T>
+Shader::Uniform<T> Shader::getUniform(const std::string& name) const
+{
+  return {getLocation(name)};
+}
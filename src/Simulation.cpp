@@ -0,0 +1,167 @@
+#include "Simulation.hpp"
+
+#include "EventManager.hpp"
+#include "Snapshot.hpp"
+#include "SimulationState.hpp"
+
+Simulation::Simulation(const std::map<int, ControllerData>& c) :
+  time(0.0),
+  deltaTime(0.0),
+  realTime(0.0),
+  realDeltaTime(0.0),
+  tickCount(0),
+  controllers(c),
+  timescaleSystem(),
+  terrain(),
+  playerSystem(terrain, controllers, timescaleSystem),
+  grenadeSystem(terrain, timescaleSystem, playerSystem),
+  powerupSystem(terrain, playerSystem)
+{
+  // Each of these reads or writes something the one before writes, so
+  // they run one after another. Only tasks added with addTask that stay
+  // clear of their resources can run beside them.
+
+  // Explosions reach terrain, players, timescale zones and the camera
+  const TaskGraph::Resources explosionListeners =
+    TERRAIN | PLAYERS | TIMESCALE | CAMERA;
+
+  tasks.add("timescale", 0, TIMESCALE, [this]() {
+      timescaleSystem.update(realTime, realDeltaTime);
+      });
+
+  tasks.add("grenades", TIMESCALE | TERRAIN | PLAYERS,
+      GRENADES | EVENTS | explosionListeners, [this]() {
+      grenadeSystem.update(deltaTime);
+      });
+
+  // Landing deforms terrain, pickups change player inventories
+  tasks.add("powerups", TERRAIN | PLAYERS,
+      POWERUPS | EVENTS | TERRAIN | PLAYERS, [this]() {
+      powerupSystem.update(deltaTime);
+      });
+
+  tasks.add("terrain", 0, TERRAIN, [this]() {
+      terrain.update(time, deltaTime);
+      });
+
+  tasks.add("players", TERRAIN | TIMESCALE | CONTROLLERS,
+      PLAYERS | EVENTS, [this]() {
+      playerSystem.update(time, deltaTime);
+      });
+}
+
+void Simulation::start()
+{
+  EventManager::Send(EvdGameStart());
+  EventManager::Flush();
+}
+
+void Simulation::tick(double dt)
+{
+  deltaTime = timescaleSystem.getGlobalTimescale() * dt;
+  time += deltaTime;
+  realTime += dt;
+  realDeltaTime = dt;
+  tickCount++;
+
+  EventManager::Update(time, deltaTime);
+
+  tasks.run();
+
+  EventManager::Flush();
+}
+
+void Simulation::addTask(const std::string& name,
+    TaskGraph::Resources reads, TaskGraph::Resources writes,
+    std::function<void()> f)
+{
+  tasks.add(name, reads, writes, f);
+}
+
+void Simulation::processInput(int controllerID, int button, bool action)
+{
+  playerSystem.processInput(controllerID, button, action);
+}
+
+void Simulation::applyInput(const InputFrame& frame)
+{
+  for (const auto& a : frame.axes) {
+    auto it = controllers.find(a.first);
+    if (it != controllers.end()) it->second.axes = a.second;
+  }
+
+  for (const auto& b : frame.buttons) {
+    auto it = controllers.find(b.controllerID);
+    if (it == controllers.end()) continue;
+
+    ControllerData& c = it->second;
+    if (b.action) c.buttons.insert(b.button);
+    else c.buttons.erase(b.button);
+
+    processInput(b.controllerID, b.button, b.action);
+  }
+}
+
+void Simulation::writeSnapshot(Snapshot& s) const
+{
+  s.tickCount = tickCount;
+  s.time = time;
+
+  s.players = playerSystem.getPlayers();
+
+  const GrenadePool& grenades = grenadeSystem.getGrenades();
+  s.grenadePositions.clear();
+  s.grenadePreviousPositions.clear();
+  for (size_t i = 0; i < grenades.size(); ++i) {
+    if (grenades.hasFlag(i, GrenadePool::AWAITING_REMOVAL)) continue;
+
+    s.grenadePositions.push_back(grenades.position[i]);
+    s.grenadePreviousPositions.push_back(grenades.previousPosition[i]);
+  }
+
+  s.powerups = powerupSystem.getPowerups();
+  s.zones = timescaleSystem.getZones();
+
+  s.terrainPoints = terrain.getPoints();
+  s.terrainHistory = terrain.getDirtyHistory();
+
+  s.terrainBasePoints = terrain.getBasePoints();
+  s.terrainBaseHistory = terrain.getBaseDirtyHistory();
+
+  s.terrainWobbles = terrain.getAppliedWobbles();
+}
+
+void Simulation::saveState(SimulationState& s) const
+{
+  s.time = time;
+  s.deltaTime = deltaTime;
+  s.realTime = realTime;
+  s.realDeltaTime = realDeltaTime;
+  s.tickCount = tickCount;
+  s.controllers = controllers;
+
+  timescaleSystem.saveState(s.timescale);
+  terrain.saveState(s.terrain);
+  playerSystem.saveState(s.players);
+  grenadeSystem.saveState(s.grenades);
+  powerupSystem.saveState(s.powerups);
+}
+
+void Simulation::restoreState(const SimulationState& s)
+{
+  time = s.time;
+  deltaTime = s.deltaTime;
+  realTime = s.realTime;
+  realDeltaTime = s.realDeltaTime;
+  tickCount = s.tickCount;
+  controllers = s.controllers;
+
+  timescaleSystem.restoreState(s.timescale);
+  terrain.restoreState(s.terrain);
+  playerSystem.restoreState(s.players);
+  grenadeSystem.restoreState(s.grenades);
+  powerupSystem.restoreState(s.powerups);
+
+  // Events sent before the next tick are stamped with this
+  EventManager::Update(time, deltaTime);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+
+#include "ControllerData.hpp"
+#include "InputFrame.hpp"
+#include "TaskGraph.hpp"
+
+#include "TimescaleSystem.hpp"
+#include "Terrain.hpp"
+#include "PlayerSystem.hpp"
+#include "GrenadeSystem.hpp"
+#include "PowerupSystem.hpp"
+
+struct Snapshot;
+struct SimulationState;
+
+// Owns the gameplay systems and steps them one logic tick at a time.
+// Nothing in here touches GLFW or OpenGL, so it can also run headless.
+class Simulation
+{
+public:
+  Simulation(const std::map<int, ControllerData>&);
+
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  // Shared state each tick task reads or writes. A task that sends events
+  // also writes whatever the listeners write.
+  enum Resource : TaskGraph::Resources {
+    TIMESCALE = 1 << 0,
+    TERRAIN = 1 << 1,
+    PLAYERS = 1 << 2,
+    GRENADES = 1 << 3,
+    POWERUPS = 1 << 4,
+    CONTROLLERS = 1 << 5,
+    EVENTS = 1 << 6,
+    // Not owned here, for systems outside the simulation that
+    // listen to its events
+    CAMERA = 1 << 7,
+  };
+
+  void start();
+  // Runs the tick tasks (see TaskGraph), then flushes any events queued
+  // during the tick (see EventManager::SetQueued)
+  void tick(double dt);
+
+  // Adds a task to every tick, after the built-in systems
+  void addTask(const std::string& name,
+      TaskGraph::Resources reads, TaskGraph::Resources writes,
+      std::function<void()>);
+
+  void processInput(int controllerID, int button, bool action);
+  // Updates the controllers and sends each button event to processInput.
+  // Input for controllers the simulation wasn't made with is ignored.
+  void applyInput(const InputFrame&);
+
+  // Copies the state renderers need into s, reusing its storage.
+  // Leaves the camera fields alone.
+  void writeSnapshot(Snapshot& s) const;
+
+  // Full gameplay state between ticks, see SimulationState.hpp. Tasks
+  // added through addTask keep their own state.
+  void saveState(SimulationState& s) const;
+  void restoreState(const SimulationState&);
+
+  double getTime() const { return time; }
+  double getDeltaTime() const { return deltaTime; }
+  unsigned long getTickCount() const { return tickCount; }
+
+  std::map<int, ControllerData>& getControllers() { return controllers; }
+
+  const TimescaleSystem& getTimescaleSystem() const { return timescaleSystem; }
+  const Terrain& getTerrain() const { return terrain; }
+  const PlayerSystem& getPlayerSystem() const { return playerSystem; }
+  const GrenadeSystem& getGrenadeSystem() const { return grenadeSystem; }
+  const PowerupSystem& getPowerupSystem() const { return powerupSystem; }
+
+private:
+  // Sim time, scaled by the global timescale
+  double time;
+  double deltaTime;
+  // Real time, advanced by the unscaled tick length
+  double realTime;
+  double realDeltaTime;
+  unsigned long tickCount;
+
+  TaskGraph tasks;
+
+  // Declaration order matters: systems hold references to earlier members
+  std::map<int, ControllerData> controllers;
+
+  TimescaleSystem timescaleSystem;
+  Terrain terrain;
+  PlayerSystem playerSystem;
+  GrenadeSystem grenadeSystem;
+  PowerupSystem powerupSystem;
+};
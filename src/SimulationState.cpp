@@ -0,0 +1,164 @@
+#include "SimulationState.hpp"
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#include "Serialize.hpp"
+
+using namespace serialize;
+
+namespace {
+
+const char MAGIC[4] = {'G', 'R', 'S', 'T'};
+const uint32_t VERSION = 4;
+
+void writeControllers(std::ostream& out,
+    const std::map<int, ControllerData>& controllers)
+{
+  writeValue<uint32_t>(out, controllers.size());
+  for (const auto& c : controllers) {
+    writeValue<int32_t>(out, c.first);
+    writeVector(out, c.second.axes);
+
+    writeValue<uint32_t>(out, c.second.buttons.size());
+    for (int b : c.second.buttons) writeValue<int32_t>(out, b);
+  }
+}
+
+bool readControllers(std::istream& in,
+    std::map<int, ControllerData>& controllers)
+{
+  uint32_t count;
+  if (!readValue(in, count)) return false;
+
+  controllers.clear();
+  for (uint32_t i = 0; i < count; ++i) {
+    int32_t id;
+    if (!readValue(in, id)) return false;
+
+    ControllerData& c = controllers[id];
+    if (!readVector(in, c.axes)) return false;
+
+    uint32_t numButtons;
+    if (!readValue(in, numButtons)) return false;
+    for (uint32_t b = 0; b < numButtons; ++b) {
+      int32_t button;
+      if (!readValue(in, button)) return false;
+      c.buttons.insert(button);
+    }
+  }
+
+  return true;
+}
+
+bool readStaleRanges(std::istream& in, uint32_t count,
+    Terrain::RangeSet& ranges)
+{
+  ranges.clear();
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t begin, end;
+    if (!readValue(in, begin) || !readValue(in, end)) return false;
+    ranges.add({size_t(begin), size_t(end)});
+  }
+
+  return true;
+}
+
+}
+
+void SimulationState::write(std::ostream& out) const
+{
+  out.write(MAGIC, sizeof(MAGIC));
+  writeValue<uint32_t>(out, VERSION);
+
+  writeValue(out, time);
+  writeValue(out, deltaTime);
+  writeValue(out, realTime);
+  writeValue(out, realDeltaTime);
+  writeValue<uint64_t>(out, tickCount);
+
+  writeControllers(out, controllers);
+
+  writeValue(out, timescale.inertiaFactor);
+  writeValue(out, timescale.globalTimescale);
+  writeVector(out, timescale.zones);
+
+  writeValue(out, terrain.time);
+  writeValue(out, terrain.maxHeight);
+  writeValue<uint64_t>(out, terrain.maxHeightIndex);
+  writeVector(out, terrain.basePoints);
+  writeVector(out, terrain.deformations);
+  writeVector(out, terrain.wobbles.origin);
+  writeVector(out, terrain.wobbles.amplitude);
+  writeVector(out, terrain.wobbles.startTime);
+  writeVector(out, terrain.wobbles.reach);
+  writeVector(out, terrain.points);
+  writeVector(out, terrain.appliedWobbles);
+  writeValue<uint32_t>(out, terrain.staleRanges.count);
+  for (const Terrain::Range& r : terrain.staleRanges) {
+    writeValue<uint64_t>(out, r.begin);
+    writeValue<uint64_t>(out, r.end);
+  }
+
+  writeVector(out, players.players);
+
+  grenades.grenades.write(out);
+  writeValue<uint64_t>(out, grenades.randomCounter);
+
+  writeVector(out, powerups.powerups);
+  writeValue<uint64_t>(out, powerups.randomCounter);
+}
+
+bool SimulationState::read(std::istream& in)
+{
+  char magic[4];
+  uint32_t version;
+  in.read(magic, sizeof(magic));
+  if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+  if (!readValue(in, version) || version != VERSION) return false;
+
+  uint64_t ticks, maxHeightIndex;
+  uint32_t numStale;
+
+  bool ok = readValue(in, time) &&
+    readValue(in, deltaTime) &&
+    readValue(in, realTime) &&
+    readValue(in, realDeltaTime) &&
+    readValue(in, ticks) &&
+
+    readControllers(in, controllers) &&
+
+    readValue(in, timescale.inertiaFactor) &&
+    readValue(in, timescale.globalTimescale) &&
+    readVector(in, timescale.zones) &&
+
+    readValue(in, terrain.time) &&
+    readValue(in, terrain.maxHeight) &&
+    readValue(in, maxHeightIndex) &&
+    readVector(in, terrain.basePoints) &&
+    readVector(in, terrain.deformations) &&
+    readVector(in, terrain.wobbles.origin) &&
+    readVector(in, terrain.wobbles.amplitude) &&
+    readVector(in, terrain.wobbles.startTime) &&
+    readVector(in, terrain.wobbles.reach) &&
+    readVector(in, terrain.points) &&
+    readVector(in, terrain.appliedWobbles) &&
+    readValue(in, numStale) &&
+    numStale <= Terrain::RangeSet::MAX_RANGES &&
+    readStaleRanges(in, numStale, terrain.staleRanges) &&
+
+    readVector(in, players.players) &&
+
+    grenades.grenades.read(in) &&
+    readValue(in, grenades.randomCounter) &&
+
+    readVector(in, powerups.powerups) &&
+    readValue(in, powerups.randomCounter);
+
+  if (!ok) return false;
+
+  tickCount = ticks;
+  terrain.maxHeightIndex = maxHeightIndex;
+  return true;
+}
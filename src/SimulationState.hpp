@@ -0,0 +1,53 @@
+#pragma once
+
+#include <iosfwd>
+#include <map>
+
+#include "ControllerData.hpp"
+#include "TimescaleSystem.hpp"
+#include "Terrain.hpp"
+#include "PlayerSystem.hpp"
+#include "GrenadeSystem.hpp"
+#include "PowerupSystem.hpp"
+
+// Full gameplay state of a Simulation between ticks. Restoring one and
+// applying the same input replays the same ticks. Made of plain-data
+// arrays, so saving into the same SimulationState again does no
+// allocation once its arrays have grown to fit.
+//
+// write() format, host byte order, arrays as uint32 count then elements:
+//   char[4]  "GRST"
+//   uint32   version
+//   float64  time, delta time, real time, real delta time
+//   uint64   tick count
+//   uint32   controller count, then per controller:
+//              int32 id, float32 axes[], int32 buttons[]
+//   timescale: float64 inertia factor, float64 global timescale, Zone[]
+//   terrain:   float64 time, float32 max height, uint64 its point index,
+//              vec2 base points[], Deformation[], wobble origin[],
+//              amplitude[], start time[], reach[], vec2 points[],
+//              AppliedWobble[], uint32 stale range count, then
+//              uint64 begin, end each
+//   players:   Player[]
+//   grenades:  GrenadePool arrays (see GrenadePool::write), uint64 counter
+//   powerups:  Powerup[], uint64 counter
+struct SimulationState
+{
+  double time;
+  double deltaTime;
+  double realTime;
+  double realDeltaTime;
+  unsigned long tickCount;
+
+  std::map<int, ControllerData> controllers;
+
+  TimescaleSystem::State timescale;
+  Terrain::State terrain;
+  PlayerSystem::State players;
+  GrenadeSystem::State grenades;
+  PowerupSystem::State powerups;
+
+  void write(std::ostream&) const;
+  // False if the stream isn't a state this version can read
+  bool read(std::istream&);
+};
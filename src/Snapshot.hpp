@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "Player.hpp"
+#include "Powerup.hpp"
+#include "Terrain.hpp"
+#include "TimescaleSystem.hpp"
+
+// Everything the renderers need from one logic tick, copied out of the
+// simulation so they can draw it on another thread (see TripleBuffer).
+// Nothing in here refers back into the live systems.
+struct Snapshot
+{
+  unsigned long tickCount = 0;
+  double time = 0.0;
+  // Real time the tick was published at, to interpolate from
+  double publishTime = 0.0;
+
+  std::vector<Player> players;
+
+  // Live grenades only
+  std::vector<glm::vec2> grenadePositions;
+  std::vector<glm::vec2> grenadePreviousPositions;
+
+  std::vector<Powerup> powerups;
+  std::vector<TimescaleSystem::Zone> zones;
+
+  std::vector<glm::vec2> terrainPoints;
+  // Lets a renderer that skipped snapshots find every point changed since
+  // the last one it saw, not just those changed in this tick
+  Terrain::DirtyHistory terrainHistory;
+
+  // The same terrain again, as base points plus the wobbles that
+  // displace them, for renderers that apply wobbles themselves
+  std::vector<glm::vec2> terrainBasePoints;
+  Terrain::DirtyHistory terrainBaseHistory;
+  std::vector<Terrain::AppliedWobble> terrainWobbles;
+
+  // Filled in by whoever owns the camera
+  glm::vec3 cameraPosition;
+  glm::vec3 cameraPreviousPosition;
+};
@@ -0,0 +1,48 @@
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float min, float max, float size) :
+  minX(min),
+  cellSize(size)
+{
+  int numCells = std::ceil((max - min) / size);
+  cells.resize(numCells > 0 ? numCells : 1);
+}
+
+void SpatialGrid::clear()
+{
+  // Cells keep their capacity, so rebuilding each tick doesn't allocate
+  for (auto& c : cells)
+    c.clear();
+}
+
+void SpatialGrid::insert(int id, float x1, float x2)
+{
+  int last = cellIndex(x2);
+  for (int i = cellIndex(x1); i <= last; ++i)
+    cells[i].push_back(id);
+}
+
+void SpatialGrid::query(float x1, float x2, std::vector<int>& ids) const
+{
+  ids.clear();
+
+  int last = cellIndex(x2);
+  for (int i = cellIndex(x1); i <= last; ++i)
+    ids.insert(ids.end(), cells[i].begin(), cells[i].end());
+
+  // Ids spanning several cells appear once per cell
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+int SpatialGrid::cellIndex(float x) const
+{
+  float i = std::floor((x - minX) / cellSize);
+
+  if (!(i > 0.f)) return 0;
+  if (i >= cells.size()) return cells.size()-1;
+  return i;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+// Uniform grid of buckets along x, for finding which ids overlap an
+// x interval without testing every one. Rebuild by calling clear() then
+// insert() for each id; x beyond the grid edges lands in the end buckets.
+class SpatialGrid
+{
+public:
+  SpatialGrid(float minX, float maxX, float cellSize);
+
+  void clear();
+  void insert(int id, float minX, float maxX);
+
+  // Replaces ids with every id inserted over [minX, maxX], ascending and
+  // without repeats. Ids may still fail an exact test.
+  void query(float minX, float maxX, std::vector<int>& ids) const;
+  // Every id inserted over the cell holding x, each once. Cheaper than
+  // query() for a point, and needs no output vector.
+  const std::vector<int>& at(float x) const { return cells[cellIndex(x)]; }
+
+private:
+  float minX;
+  float cellSize;
+  std::vector<std::vector<int>> cells;
+
+  int cellIndex(float x) const;
+};
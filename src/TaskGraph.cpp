@@ -0,0 +1,37 @@
+#include "TaskGraph.hpp"
+
+#include "JobSystem.hpp"
+
+void TaskGraph::add(const std::string& name, Resources reads,
+    Resources writes, std::function<void()> func)
+{
+  // One wave after the latest earlier task this conflicts with
+  int wave = 0;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    const Task& t = tasks[i];
+
+    bool conflict = (reads & t.writes) || (writes & (t.reads | t.writes));
+    if (conflict && waves[i] + 1 > wave) wave = waves[i] + 1;
+  }
+
+  tasks.push_back({name, reads, writes, func});
+  waves.push_back(wave);
+
+  if (schedule.size() < size_t(wave) + 1) schedule.resize(wave + 1);
+  schedule[wave].push_back(tasks.size() - 1);
+}
+
+void TaskGraph::run()
+{
+  for (const auto& wave : schedule) {
+    if (wave.size() == 1) {
+      tasks[wave.front()].func();
+      continue;
+    }
+
+    JobSystem::ParallelFor(wave.size(), 1, [&](size_t begin, size_t end) {
+	for (size_t i = begin; i < end; ++i)
+	  tasks[wave[i]].func();
+	});
+  }
+}
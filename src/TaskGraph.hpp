@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <string>
+
+// Steps that declare which shared resources they read and write. Run
+// executes them in waves through JobSystem: a task waits for every
+// earlier task it conflicts with (it reads what they write, or writes
+// what they read or write), and tasks in the same wave run in parallel.
+// Declaration order is the serial order, so the outcome matches running
+// the tasks one by one in that order.
+class TaskGraph
+{
+public:
+  // Bitmask, the meaning of each bit is up to the owner
+  typedef unsigned int Resources;
+
+  void add(const std::string& name, Resources reads, Resources writes,
+      std::function<void()>);
+  void run();
+
+  // Wave each task runs in, by declaration order
+  const std::vector<int>& getWaves() const { return waves; }
+
+private:
+  struct Task {
+    std::string name;
+    Resources reads;
+    Resources writes;
+    std::function<void()> func;
+  };
+
+  std::vector<Task> tasks;
+  std::vector<int> waves;
+  // Task indices grouped by wave
+  std::vector<std::vector<size_t>> schedule;
+};
@@ -3,201 +3,524 @@
 
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <iostream>
 
+#include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/trigonometric.hpp>
 #include "geo.hpp"
 
 #include "EventManager.hpp"
-#include "ResourceManager.hpp"
 #include "Grenade.hpp"
 #include "Powerup.hpp"
 #include "Console.hpp"
 
 Terrain::Terrain() :
+  time(0.0),
   maxDepth(-400.f),
-  maxWidth(10000.f)
+  maxWidth(10000.f),
+  maxHeight(0.f),
+  maxHeightIndex(0),
+  staleRanges(),
+  dirtyHistory(),
+  baseDirtyHistory()
 {
+  RandomStream random = Random::stream(Random::TERRAIN);
   for (float i = 0.f; i < maxWidth; i += PRECISION) {
-    basePoints.push_back({i, -Random::randomFloat(0.f, 10.f)});
+    basePoints.push_back({i, -random.randomFloat(0.f, 10.f)});
   }
   maxWidth = basePoints.back().x;
   points = basePoints;
 
-  EventManager::Register(Event::Type::EXPLOSION,
-      std::bind(&Terrain::onExplosion, this, _1));
-  EventManager::Register(Event::Type::POWERUP_LAND,
-      std::bind(&Terrain::onPowerupLand, this, _1));
+  for (const auto& p : points) {
+    pointXs.push_back(p.x);
+  }
+  offsets.assign(points.size(), 0.f);
+  findMaxHeight();
+
+  originX = basePoints.front().x;
+  uniform = true;
+  for (size_t i = 0; i < basePoints.size(); ++i) {
+    if (glm::abs(basePoints[i].x - (originX + i*PRECISION)) > 0.001f) {
+      uniform = false;
+      break;
+    }
+  }
+
+  size_t n = points.size();
+  falloffSteps.resize(2 * n);
+  for (size_t d = 0; d < n; ++d) {
+    float f = glm::exp(-(d * PRECISION) / 200.f);
+    falloffSteps[n + d] = f;
+    falloffSteps[n - 1 - d] = f;
+  }
+
+  eventHandles.push_back(EventManager::Register<EvdGrenadeExplosion>(
+      std::bind(&Terrain::onExplosion, this, _1, _2), this));
+  eventHandles.push_back(EventManager::Register<EvdPowerupLand>(
+      std::bind(&Terrain::onPowerupLand, this, _1, _2), this));
 }
 
-float Terrain::getHeight(float x) const
+Terrain::~Terrain()
 {
-  for (size_t i = 0; i < points.size(); ++i) {
-    glm::vec2 p1 = points[i];
+  for (auto h : eventHandles)
+    EventManager::Unregister(h);
+}
 
-    if (x < p1.x) {
+size_t Terrain::upperIndex(float x) const
+{
+  if (!uniform) {
+    auto it = std::upper_bound(points.begin(), points.end(), x,
+	[](float x, const glm::vec2& p) -> bool {
+	return x < p.x;
+	});
+    return it - points.begin();
+  }
 
-      // Before first point
-      if (i == 0) return -1000.f;
-      glm::vec2 p2 = points[i-1];
+  float bucket = glm::floor((x - originX) / PRECISION) + 1.f;
+  if (bucket <= 0.f) return 0;
+  if (bucket >= points.size()) return points.size();
 
-      float a = (x - p1.x) / (p2.x - p1.x);
-      float y = p1.y + (p2.y - p1.y) * a;
+  size_t i = bucket;
 
-      return y;
-    }
-  }
+  // Nudge for float error right on a point
+  while (i > 0 && x < points[i-1].x) --i;
+  while (i < points.size() && x >= points[i].x) ++i;
+
+  return i;
+}
+
+float Terrain::getHeight(float x) const
+{
+  size_t i = upperIndex(x);
+
+  // Before first point or after last point
+  if (i == 0 || i == points.size()) return -1000.f;
+
+  glm::vec2 p1 = points[i];
+  glm::vec2 p2 = points[i-1];
 
-  return -1000.f;
+  float a = (x - p1.x) / (p2.x - p1.x);
+  float y = p1.y + (p2.y - p1.y) * a;
+
+  return y;
 }
 
 float Terrain::getAngle(float x) const
 {
-  for (size_t i = 0; i < points.size(); ++i) {
-    glm::vec2 p1 = points[i];
+  size_t i = upperIndex(x);
 
-    if (x < p1.x) {
-      if (i == 0) return 0.f;
-      glm::vec2 p2 = points[i-1];
+  if (i == 0 || i == points.size()) return 0.f;
 
-      return glm::atan((p2.y - p1.y) / (p2.x - p1.x));
-    }
+  glm::vec2 p1 = points[i];
+  glm::vec2 p2 = points[i-1];
+
+  return glm::atan((p2.y - p1.y) / (p2.x - p1.x));
+}
+
+void Terrain::getHeights(const float* xs, float* heights, size_t count) const
+{
+  for (size_t i = 0; i < count; ++i) {
+    heights[i] = getHeight(xs[i]);
+  }
+}
+
+std::pair<bool, glm::vec2> Terrain::intersect(glm::vec2 p1, glm::vec2 p2) const
+{
+  auto intersection = std::make_pair(false, glm::vec2());
+
+  forEachSegmentInRange(p1.x, p2.x, [&](glm::vec2 a, glm::vec2 b) -> bool {
+      intersection = geo::intersect(a, b, p1, p2);
+      return intersection.first;
+      });
+
+  return intersection;
+}
+
+void Terrain::Range::extend(Range r)
+{
+  if (r.empty()) return;
+  if (empty()) {
+    *this = r;
+    return;
   }
 
-  return 0.f;
+  if (r.begin < begin) begin = r.begin;
+  if (r.end > end) end = r.end;
 }
 
-std::vector<LineSegment> Terrain::getSegmentsInRange(float x1, float x2) const
+Terrain::Range Terrain::pointsInRange(float minX, float maxX) const
 {
-  std::vector<LineSegment> ret;
+  // First point >= minX, first point > maxX
+  size_t begin = upperIndex(minX);
+  if (begin > 0 && points[begin-1].x == minX) begin--;
+
+  return {begin, upperIndex(maxX)};
+}
 
-  bool reverse = false;
-  if (x1 > x2) {
-    reverse = true;
-    float t = x1;
-    x1 = x2;
-    x2 = t;
+void Terrain::RangeSet::add(Range r)
+{
+  if (r.empty()) return;
+
+  // Ranges before r that don't touch it, then the ones r swallows
+  size_t first = 0;
+  while (first < count && ranges[first].end < r.begin) first++;
+  size_t last = first;
+  while (last < count && ranges[last].begin <= r.end) {
+    r.extend(ranges[last]);
+    last++;
   }
 
-  for (size_t i = 1; i < points.size(); ++i) {
-    glm::vec2 a = points[i-1];
-    glm::vec2 b = points[i];
+  if (first == last && count == MAX_RANGES) {
+    // Full, close the smallest gap. If that gap is next to r, r grows
+    // into its neighbour, otherwise merge the pair and try again.
+    size_t gap = ~size_t(0);
+    size_t at = 0;
+    for (size_t i = 1; i < count; ++i) {
+      if (ranges[i].begin - ranges[i-1].end < gap) {
+	gap = ranges[i].begin - ranges[i-1].end;
+	at = i;
+      }
+    }
 
-    if ((x1 > a.x && x1 < b.x) ||
-	(x2 > a.x && x2 < b.x)) {
-	ret.push_back({a, b});
-	}
+    if (first > 0 && r.begin - ranges[first-1].end < gap) {
+      ranges[first-1].end = r.end;
+      return;
+    }
+    if (first < count && ranges[first].begin - r.end < gap) {
+      ranges[first].begin = r.begin;
+      return;
+    }
+
+    ranges[at-1].end = ranges[at].end;
+    for (size_t i = at; i+1 < count; ++i) ranges[i] = ranges[i+1];
+    count--;
+
+    add(r);
+    return;
+  }
+
+  // Replace [first, last) with r
+  if (first == last) {
+    for (size_t i = count; i > first; --i) ranges[i] = ranges[i-1];
+    count++;
+  }
+  else {
+    size_t removed = last - first - 1;
+    for (size_t i = last; i < count; ++i) ranges[i - removed] = ranges[i];
+    count -= removed;
   }
 
-  if (reverse)
-    std::reverse(ret.begin(), ret.end());
+  ranges[first] = r;
+}
 
-  return ret;
+void Terrain::RangeSet::merge(const RangeSet& s)
+{
+  for (const Range& r : s) add(r);
 }
 
-std::pair<bool, glm::vec2> Terrain::intersect(glm::vec2 p1, glm::vec2 p2) const
+Terrain::RangeSet Terrain::getDirtyRanges(unsigned long since) const
+{
+  return dirtyHistory.since(since, points.size());
+}
+
+void Terrain::DirtyHistory::record(const RangeSet& r)
+{
+  updateCount++;
+  ranges[updateCount % DIRTY_HISTORY] = r;
+}
+
+Terrain::RangeSet Terrain::DirtyHistory::since(unsigned long since,
+    size_t numPoints) const
 {
-  std::vector<LineSegment> tSegments = getSegmentsInRange(p1.x, p2.x);
-  for (auto& s : tSegments) {
-    auto intersection = geo::intersect(s.first, s.second, p1, p2);
-    if (intersection.first)
-      return intersection;
+  RangeSet set;
+
+  // Too far behind to know, everything may have changed
+  if (updateCount - since > DIRTY_HISTORY) {
+    set.add({0, numPoints});
+    return set;
+  }
+
+  for (unsigned long i = since+1; i <= updateCount; ++i) {
+    set.merge(ranges[i % DIRTY_HISTORY]);
   }
 
-  return std::make_pair(false, glm::vec2());
+  return set;
 }
 
-void Terrain::update(double t, double dt) {
-  time = t;
+void TerrainWobbles::add(float o, float a, double t, float r)
+{
+  origin.push_back(o);
+  amplitude.push_back(a);
+  startTime.push_back(t);
+  reach.push_back(r);
+}
 
-  points = basePoints;
+void TerrainWobbles::removeOldest(size_t n)
+{
+  if (n == 0) return;
 
-  // Remove old modifiers
-  modifiers.erase(std::remove_if(modifiers.begin(), modifiers.end(),
-	[](const TerrainPointModifier& m) -> bool {
-	return m.age > m.lifetime;
-	}), modifiers.end());
+  origin.erase(origin.begin(), origin.begin() + n);
+  amplitude.erase(amplitude.begin(), amplitude.begin() + n);
+  startTime.erase(startTime.begin(), startTime.begin() + n);
+  reach.erase(reach.begin(), reach.begin() + n);
+}
 
-  for (auto& m : modifiers) {
-    m.age += dt;
+namespace {
 
-    for (auto& p : points) {
-      p.y += m.func(p.x, t);
-    }
+// Adds one side of a wobble's precomputed falloff to a run of contiguous
+// points. No calls or branches, so GCC vectorizes it at -O3 (check with
+// -fopt-info-vec).
+void wobbleKernel(const float* __restrict steps, float* __restrict offsets,
+    size_t count, float scale)
+{
+  for (size_t i = 0; i < count; ++i) {
+    offsets[i] += scale * steps[i];
   }
 }
 
-void Terrain::addFunc(
-    const std::function<float(float, double)>& func,
-    double lifetime)
+}
+
+void Terrain::addWobbleOffsets(size_t w, size_t begin, size_t end)
 {
-  while (modifiers.size() > MAX_MODIFIERS) {
-    modifiers.pop_front();
+  float origin = appliedWobbles[w].origin;
+  float scale = appliedWobbles[w].scale;
+
+  if (!uniform) {
+    for (size_t i = begin; i < end; ++i) {
+      offsets[i] += scale * glm::exp(-glm::abs(pointXs[i] - origin) / 200.f);
+    }
+    return;
   }
 
-  TerrainPointModifier m;
-  m.lifetime = lifetime;
-  m.age = 0.0f;
-  m.func = func;
+  // First point at or right of the origin
+  size_t n = points.size();
+  float split = glm::ceil((origin - originX) / PRECISION);
+  size_t right = split <= 0.f ? 0 : split >= n ? n : size_t(split);
+
+  // Each side scales its steps by the falloff to the point nearest the
+  // origin, which is a fraction of a step away
+  size_t leftEnd = end < right ? end : right;
+  if (begin < leftEnd) {
+    float nearest = scale * glm::exp(-(origin - pointXs[right-1]) / 200.f);
+    wobbleKernel(&falloffSteps[n + begin - right], &offsets[begin],
+	leftEnd - begin, nearest);
+  }
 
-  modifiers.push_back(m);
+  size_t rightBegin = begin > right ? begin : right;
+  if (rightBegin < end) {
+    float nearest = scale * glm::exp(-(pointXs[right] - origin) / 200.f);
+    wobbleKernel(&falloffSteps[n + rightBegin - right], &offsets[rightBegin],
+	end - rightBegin, nearest);
+  }
 }
 
-void Terrain::wobble(float xpos, float amplitude)
+void Terrain::saveState(State& s) const
 {
-  // Wobble terrain
-  double currentTime = time;
-  addFunc([=](float x, double t) -> float {
+  s.time = time;
+  s.maxHeight = maxHeight;
+  s.maxHeightIndex = maxHeightIndex;
+  s.basePoints = basePoints;
+  s.deformations = deformations;
+  s.wobbles = wobbles;
+  s.points = points;
+  s.appliedWobbles = appliedWobbles;
+  s.staleRanges = staleRanges;
+}
+
+void Terrain::restoreState(const State& s)
+{
+  time = s.time;
+  maxHeight = s.maxHeight;
+  maxHeightIndex = s.maxHeightIndex;
+  basePoints = s.basePoints;
+  deformations = s.deformations;
+  wobbles = s.wobbles;
+  points = s.points;
+  appliedWobbles = s.appliedWobbles;
+  staleRanges = s.staleRanges;
+
+  RangeSet all;
+  all.add({0, points.size()});
+  dirtyHistory.record(all);
+  baseDirtyHistory.record(all);
+}
+
+void Terrain::update(double t, double) {
+  time = t;
+
+  RangeSet deformed = applyDeformations();
+
+  // Remove old wobbles. All share a lifetime, so they expire in order.
+  size_t expired = 0;
+  while (expired < wobbles.size() &&
+      t - wobbles.startTime[expired] > WOBBLE_LIFETIME) {
+    expired++;
+  }
+  wobbles.removeOldest(expired);
+
+  // Rebuild anything stale from last tick, and everything wobbling this tick
+  RangeSet dirty = staleRanges;
+  RangeSet modified;
+
+  wobbleRanges.resize(wobbles.size());
+  appliedWobbles.resize(wobbles.size());
+
+  for (size_t w = 0; w < wobbles.size(); ++w) {
+    float dt = t - wobbles.startTime[w];
+
+    // Oscillate up and down over time
+    float r = wobbles.amplitude[w] * glm::cos(15.f*dt + glm::half_pi<float>());
+
+    // Fade out over time
+    float mt = glm::exp(-3.5f*dt);
+
+    appliedWobbles[w] = {wobbles.origin[w], r * mt, wobbles.reach[w]};
+    wobbleRanges[w] = pointsInRange(
+	wobbles.origin[w] - wobbles.reach[w],
+	wobbles.origin[w] + wobbles.reach[w]);
+
+    modified.add(wobbleRanges[w]);
+  }
+  dirty.merge(modified);
+
+  // Each point sums its wobbles in the same order wherever its range starts
+  for (const Range& range : dirty) {
+    for (size_t i = range.begin; i < range.end; ++i) {
+      offsets[i] = 0.f;
+    }
+
+    // Fade out over distance, per point
+    for (size_t w = 0; w < wobbles.size(); ++w) {
+      size_t b = wobbleRanges[w].begin > range.begin ?
+	wobbleRanges[w].begin : range.begin;
+      size_t e = wobbleRanges[w].end < range.end ?
+	wobbleRanges[w].end : range.end;
+      if (b >= e) continue;
 
-      float dt = t - currentTime;
+      addWobbleOffsets(w, b, e);
+    }
+
+    for (size_t i = range.begin; i < range.end; ++i) {
+      points[i].y = basePoints[i].y + offsets[i];
+    }
+  }
+
+  // The old highest point may have dropped, then anywhere could be highest
+  bool rebuiltMax = false;
+  for (const Range& range : dirty) {
+    if (maxHeightIndex >= range.begin && maxHeightIndex < range.end)
+      rebuiltMax = true;
+  }
+
+  if (rebuiltMax) {
+    findMaxHeight();
+  }
+  else {
+    for (const Range& range : dirty) {
+      for (size_t i = range.begin; i < range.end; ++i) {
+	if (points[i].y > maxHeight) {
+	  maxHeight = points[i].y;
+	  maxHeightIndex = i;
+	}
+      }
+    }
+  }
+
+  // Wobbling points must be restored once their wobbles expire
+  staleRanges = modified;
 
-      // Oscillate up and down over time
-      float r = amplitude * glm::cos(15.f*dt + glm::half_pi<float>());
+  dirtyHistory.record(dirty);
+  baseDirtyHistory.record(deformed);
+}
 
-      // Fade out over time
-      float mt = glm::exp(-3.5f*dt);
+void Terrain::findMaxHeight()
+{
+  maxHeight = -geo::inf<float>();
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (points[i].y > maxHeight) {
+      maxHeight = points[i].y;
+      maxHeightIndex = i;
+    }
+  }
+}
 
-      // Fade out over distance
-      float dx = glm::abs(x - xpos);
-      float mx = glm::exp(-dx / 200.f);
+void Terrain::wobble(float xpos, float amplitude)
+{
+  // Distance at which the wobble falls below WOBBLE_EPSILON
+  float reach = 0.f;
+  if (glm::abs(amplitude) > WOBBLE_EPSILON)
+    reach = 200.f * glm::log(glm::abs(amplitude) / WOBBLE_EPSILON);
+
+  // Make room by dropping the oldest
+  if (wobbles.size() >= MAX_WOBBLES) {
+    wobbles.removeOldest(wobbles.size() - MAX_WOBBLES + 1);
+  }
 
-      return r * mx * mt;
-      }, 4.0);
+  wobbles.add(xpos, amplitude, time, reach);
 }
 
 void Terrain::deform(glm::vec2 pos, float radius, float depthModifier)
 {
-  for (auto& p : basePoints) {
-    float distance = glm::distance(pos, p);
-    if (distance < radius) {
-      // Create hole in ground
-      p.y -= 0.1f * radius * depthModifier *
-	glm::cos(glm::half_pi<float>() * (distance/radius)) *
-	(1 - p.y / maxDepth);
+  deformations.push_back({pos, radius, depthModifier});
+}
+
+Terrain::RangeSet Terrain::applyDeformations()
+{
+  RangeSet changed;
+  if (deformations.empty()) return changed;
 
-      if (p.y < maxDepth) p.y = maxDepth;
+  // Only points within radius in x can be affected
+  for (const auto& d : deformations) {
+    changed.add({upperIndex(d.position.x - d.radius),
+	upperIndex(d.position.x + d.radius)});
+  }
+
+  staleRanges.merge(changed);
+
+  // One pass over the affected points, applying each deformation in the
+  // order it arrived, so overlapping holes stack as they always have
+  for (const Range& range : changed) {
+    for (size_t i = range.begin; i < range.end; ++i) {
+      auto& p = basePoints[i];
+
+      for (const auto& d : deformations) {
+	float distance = glm::distance(d.position, p);
+	if (distance < d.radius) {
+	  // Create hole in ground
+	  p.y -= 0.1f * d.radius * d.depth *
+	    glm::cos(glm::half_pi<float>() * (distance/d.radius)) *
+	    (1 - p.y / maxDepth);
+
+	  if (p.y < maxDepth) p.y = maxDepth;
+	}
+      }
     }
   }
+
+  deformations.clear();
+
+  return changed;
 }
 
-void Terrain::onExplosion(const Event& e)
+void Terrain::onExplosion(const Event&, const EvdGrenadeExplosion& d)
 {
-  const auto* g = boost::any_cast<EvdGrenadeExplosion>(e.data).grenade;
+  const auto& properties = Grenade::getProperties(d.type);
 
-  if (g->properties.radius == 0.f) return;
+  if (properties.radius == 0.f) return;
 
-  deform(g->position, g->properties.radius, g->properties.terrainDamageModifier);
+  deform(d.position, properties.radius, properties.terrainDamageModifier);
 
-  float wobbleAmount = 15.f * g->properties.terrainWobbleModifier;
-  if ((g->position.y - getHeight(g->position.x)) / g->properties.radius < 1.f) {
-    wobble(g->position.x, wobbleAmount);
+  float wobbleAmount = 15.f * properties.terrainWobbleModifier;
+  if ((d.position.y - getHeight(d.position.x)) / properties.radius < 1.f) {
+    wobble(d.position.x, wobbleAmount);
   }
 }
 
-void Terrain::onPowerupLand(const Event& e)
+void Terrain::onPowerupLand(const Event&, const EvdPowerupLand& d)
 {
-  const Powerup* p = boost::any_cast<EvdPowerupLand>(e.data).powerup;
+  const Powerup* p = &d.powerup;
   deform(p->position, 90.f, 1.f);
   wobble(p->position.x, 15.f);
 }
@@ -1,54 +1,237 @@
 #pragma once
 
 #include <vector>
-#include <deque>
-#include <functional>
 #include <glm/vec2.hpp>
 #include "geo.hpp"
 
 #include "Event.hpp"
+#include "EventManager.hpp"
 
-struct TerrainPointModifier
+// Active terrain wobbles, stored as parallel arrays ordered by start time
+struct TerrainWobbles
 {
-  std::function<float(float x, double t)> func;
-  double age;
-  double lifetime;
+  std::vector<float> origin;
+  std::vector<float> amplitude;
+  std::vector<double> startTime;
+  // Points further than reach from origin are assumed unaffected
+  std::vector<float> reach;
+
+  size_t size() const { return origin.size(); }
+  void add(float origin, float amplitude, double startTime, float reach);
+  // Remove the n oldest
+  void removeOldest(size_t n);
 };
 
 class Terrain {
 public:
   Terrain();
+  ~Terrain();
 
   static constexpr float PRECISION = 50.f;
-  static constexpr float MAX_MODIFIERS = 4.f;
+  static constexpr int MAX_WOBBLES = 256;
+  static constexpr double WOBBLE_LIFETIME = 4.0;
+  // Wobble offsets smaller than this are not applied
+  static constexpr float WOBBLE_EPSILON = 0.01f;
+  static constexpr int DIRTY_HISTORY = 16;
+
+  // Half-open range of point indices
+  struct Range {
+    size_t begin;
+    size_t end;
+
+    bool empty() const { return begin >= end; }
+    void extend(Range);
+  };
+
+  // Sorted, disjoint ranges, so far apart wobbles don't drag everything
+  // between them along. Past MAX_RANGES the two closest are merged, which
+  // may cover points that didn't change but never misses one.
+  struct RangeSet {
+    static constexpr size_t MAX_RANGES = 8;
+
+    size_t count = 0;
+    Range ranges[MAX_RANGES] = {};
+
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+    void add(Range);
+    void merge(const RangeSet&);
+
+    const Range* begin() const { return ranges; }
+    const Range* end() const { return ranges + count; }
+  };
+
+  // Points rebuilt by each of the last DIRTY_HISTORY updates. Plain data,
+  // so it can be copied out alongside the points it describes.
+  struct DirtyHistory {
+    unsigned long updateCount = 0;
+    RangeSet ranges[DIRTY_HISTORY] = {};
+
+    void record(const RangeSet&);
+    // Points changed by the updates after sinceUpdateCount,
+    // all numPoints if that is too far back to know
+    RangeSet since(unsigned long sinceUpdateCount, size_t numPoints) const;
+  };
+
+  // A wobble as update() last applied it. Terrain::wobble can drop the
+  // oldest wobbles before the next update, so these are kept whole
+  // rather than matched up with getWobbles() by index.
+  struct AppliedWobble {
+    float origin;
+    // Falloff scale, amplitude faded over time
+    float scale;
+    float reach;
+  };
+
+  // Deformations are collected as events arrive and all applied
+  // together at the start of the next update
+  struct Deformation {
+    glm::vec2 position;
+    float radius;
+    float depth;
+  };
+
+  // Everything update() carries from one tick to the next. Scratch
+  // arrays are left out, they're rebuilt before being read.
+  struct State {
+    double time;
+    float maxHeight;
+    size_t maxHeightIndex;
+    std::vector<glm::vec2> basePoints;
+    std::vector<Deformation> deformations;
+    TerrainWobbles wobbles;
+    std::vector<glm::vec2> points;
+    std::vector<AppliedWobble> appliedWobbles;
+    RangeSet staleRanges;
+  };
+
+  // Copies into s, reusing its storage
+  void saveState(State& s) const;
+  // The dirty histories carry on counting and mark every point changed,
+  // so consumers of getDirtyRanges see the jump
+  void restoreState(const State&);
 
   float getMaxDepth() const { return maxDepth; }
   float getMaxWidth() const { return maxWidth; }
+  // Highest point as of the last update, nothing above it can hit terrain
+  float getMaxHeight() const { return maxHeight; }
 
   float getHeight(float x) const;
   float getAngle(float x) const;
+  void getHeights(const float* xs, float* heights, size_t count) const;
 
-  std::vector<LineSegment> getSegmentsInRange(float x1, float  x2) const;
+  // Calls f(a, b) for every segment touching [x1, x2], ordered from x1
+  // towards x2. Stops and returns true as soon as f returns true.
+  template <typename F>
+    bool forEachSegmentInRange(float x1, float x2, F f) const;
   std::pair<bool, glm::vec2> intersect(glm::vec2, glm::vec2) const;
 
   const std::vector<glm::vec2>& getPoints() const { return points; }
+  const TerrainWobbles& getWobbles() const { return wobbles; }
+  // Points before wobbles, only changed by deformations
+  const std::vector<glm::vec2>& getBasePoints() const { return basePoints; }
+  // Wobbles as of the last update. Wobbles added since aren't applied yet.
+  const std::vector<AppliedWobble>& getAppliedWobbles() const {
+    return appliedWobbles;
+  }
+
+  // Number of update() calls so far. Consumers remember this and pass it
+  // back to getDirtyRanges to find which points changed in the meantime.
+  unsigned long getUpdateCount() const { return dirtyHistory.updateCount; }
+  RangeSet getDirtyRanges(unsigned long sinceUpdateCount) const;
+  const DirtyHistory& getDirtyHistory() const { return dirtyHistory; }
+  // As above, but for base points
+  const DirtyHistory& getBaseDirtyHistory() const { return baseDirtyHistory; }
 
   void update(double t, double dt);
-  void addFunc(const std::function<float(float x, double t)>&, double);
 
 private:
   double time;
 
+  // Index of the first point right of x, or points.size() if there is none
+  size_t upperIndex(float x) const;
+  // Indices of the points within [minX, maxX]
+  Range pointsInRange(float minX, float maxX) const;
+
   void wobble(float x, float amplitude);
+
   void deform(glm::vec2 position, float radius, float depth);
+  // Returns the base points changed
+  RangeSet applyDeformations();
 
-  void onExplosion(const Event& e);
-  void onPowerupLand(const Event& e);
+  void onExplosion(const Event&, const EvdGrenadeExplosion&);
+  void onPowerupLand(const Event&, const EvdPowerupLand&);
+  std::vector<EventManager::Handle> eventHandles;
 
   float maxDepth;
   float maxWidth;
+  float maxHeight;
+  // The point at maxHeight. While it isn't rebuilt, only rebuilt points
+  // can rise above it, so update() needn't scan the rest.
+  size_t maxHeightIndex;
+  void findMaxHeight();
+
+  // Points are evenly spaced at PRECISION from originX,
+  // so they can be indexed directly instead of searched
+  bool uniform;
+  float originX;
 
   std::vector<glm::vec2> basePoints;
-  std::deque<TerrainPointModifier> modifiers;
+  std::vector<Deformation> deformations;
+  TerrainWobbles wobbles;
   std::vector<glm::vec2> points;
+
+  // Contiguous point x coordinates and summed wobble offsets,
+  // so the wobble kernel streams plain float arrays
+  std::vector<float> pointXs;
+  std::vector<float> offsets;
+  // Wobble falloff exp(-dx/200) between evenly spaced points is a power
+  // of the falloff over one step: falloffSteps[n + d] is that power for
+  // the d-th point right of a wobble (d >= 0), or the (-d-1)-th point
+  // left of it (d < 0), for n points. Lets the kernel skip exp entirely.
+  std::vector<float> falloffSteps;
+  // Adds wobble w's falloff to the points in [begin, end)
+  void addWobbleOffsets(size_t w, size_t begin, size_t end);
+  // This update's wobbles and the points each affects
+  std::vector<AppliedWobble> appliedWobbles;
+  std::vector<Range> wobbleRanges;
+
+  // Points that no longer match basePoints + wobbles and must be
+  // rebuilt next update: last update's wobble extents, plus deformations
+  RangeSet staleRanges;
+
+  DirtyHistory dirtyHistory;
+  DirtyHistory baseDirtyHistory;
 };
+
+// IMPL
+template <typename F>
+bool Terrain::forEachSegmentInRange(float x1, float x2, F f) const
+{
+  if (points.size() < 2) return false;
+
+  float lo = x1 < x2 ? x1 : x2;
+  float hi = x1 < x2 ? x2 : x1;
+
+  // Segment i runs from points[i-1] to points[i]
+  size_t first = upperIndex(lo);
+  size_t last = upperIndex(hi);
+
+  // Range starts exactly on a point, include the segment ending there
+  if (first > 1 && points[first-1].x == lo) first--;
+
+  if (first < 1) first = 1;
+  if (last > points.size()-1) last = points.size()-1;
+  if (first > last) return false;
+
+  if (x1 <= x2) {
+    for (size_t i = first; i <= last; ++i)
+      if (f(points[i-1], points[i])) return true;
+  }
+  else {
+    for (size_t i = last; i >= first; --i)
+      if (f(points[i-1], points[i])) return true;
+  }
+
+  return false;
+}
@@ -7,12 +7,18 @@
 
 #include "Grenade.hpp"
 
-TimescaleSystem::TimescaleSystem()
+TimescaleSystem::TimescaleSystem() :
+  grid(GRID_MIN_X, GRID_MAX_X, GRID_CELL_SIZE)
 {
   globalTimescale = 1.0;
 
-  EventManager::Register(Event::Type::EXPLOSION,
-      std::bind(&TimescaleSystem::onExplosion, this, _1));
+  explosionHandle = EventManager::Register<EvdGrenadeExplosion>(
+      std::bind(&TimescaleSystem::onExplosion, this, _1, _2), this);
+}
+
+TimescaleSystem::~TimescaleSystem()
+{
+  EventManager::Unregister(explosionHandle);
 }
 
 void TimescaleSystem::update(double t, double dt)
@@ -37,14 +43,54 @@ void TimescaleSystem::update(double t, double dt)
       [](const Zone& z) -> bool {
       return z.age > z.lifetime;
       }), zones.end());
+
+  updateGrid();
+}
+
+void TimescaleSystem::saveState(State& s) const
+{
+  s.inertiaFactor = inertiaFactor;
+  s.globalTimescale = globalTimescale;
+  s.zones = zones;
+}
+
+void TimescaleSystem::restoreState(const State& s)
+{
+  inertiaFactor = s.inertiaFactor;
+  globalTimescale = s.globalTimescale;
+  zones = s.zones;
+  updateGrid();
+}
+
+void TimescaleSystem::updateGrid()
+{
+  grid.clear();
+  for (size_t i = 0; i < zones.size(); ++i) {
+    const Zone& z = zones[i];
+    grid.insert(i, z.position.x - z.radius, z.position.x + z.radius);
+  }
+}
+
+void TimescaleSystem::getTimescales(const glm::vec2* positions,
+    double* timescales, size_t count) const
+{
+  if (zones.empty()) {
+    for (size_t i = 0; i < count; ++i) timescales[i] = 1.0;
+    return;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    timescales[i] = getTimescaleAtPosition(positions[i]);
+  }
 }
 
 double TimescaleSystem::getTimescaleAtPosition(glm::vec2 p) const
 {
-  // Pick slowest timescale
+  // Pick slowest timescale, of the zones that could reach p
   bool insideZone = false;
   double timescale = geo::inf<double>();
-  for (const auto& z : zones) {
+  for (int id : grid.at(p.x)) {
+    const Zone& z = zones[id];
     float sqdist = geo::sqdist(p, z.position);
     if (sqdist < geo::sq(z.radius)) {
       insideZone = true;
@@ -69,17 +115,19 @@ TimescaleSystem::Zone& TimescaleSystem::addZone()
   return zones.back();
 }
 
-void TimescaleSystem::onExplosion(const Event& e)
+void TimescaleSystem::onExplosion(const Event&, const EvdGrenadeExplosion& d)
 {
-  const Grenade* g = boost::any_cast<EvdGrenadeExplosion>(e.data).grenade;
+  const auto& properties = Grenade::getProperties(d.type);
 
-  if (g->properties.spawnInertiaZone) {
+  if (properties.spawnInertiaZone) {
     Zone& z = addZone();
-    z.position = g->position;
+    z.position = d.position;
     z.lifetime = 5.0;
     z.age = 0.0;
-    z.radius = g->properties.radius;
+    z.radius = properties.radius;
     z.initialTimescale = 0.05f;
     z.timescale = z.initialTimescale;
+
+    updateGrid();
   }
 }
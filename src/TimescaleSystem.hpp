@@ -3,6 +3,9 @@
 #include <glm/vec2.hpp>
 #include <vector>
 
+#include "EventManager.hpp"
+#include "SpatialGrid.hpp"
+
 struct Event;
 
 class TimescaleSystem
@@ -17,13 +20,34 @@ public:
     double timescale;
   };
 
+  // Everything update() carries from one tick to the next
+  struct State {
+    double inertiaFactor;
+    double globalTimescale;
+    std::vector<Zone> zones;
+  };
+
   TimescaleSystem();
+  ~TimescaleSystem();
+
+  // Copies into s, reusing its storage
+  void saveState(State& s) const;
+  void restoreState(const State&);
 
   void update(double t, double dt);
   double getGlobalTimescale() const { return globalTimescale; }
   double getTimescaleAtPosition (glm::vec2) const;
+  // getTimescaleAtPosition for many positions at once
+  void getTimescales(const glm::vec2* positions, double* timescales,
+      size_t count) const;
   const std::vector<Zone>& getZones() const { return zones; }
 
+  // Zones are bucketed along x over this range, further out they
+  // share the end buckets
+  static constexpr float GRID_MIN_X = 0.f;
+  static constexpr float GRID_MAX_X = 10000.f;
+  static constexpr float GRID_CELL_SIZE = 256.f;
+
 private:
   double inertiaFactor;
   double globalTimescale;
@@ -31,5 +55,10 @@ private:
   std::vector<Zone> zones;
   Zone& addZone();
 
-  void onExplosion(const Event&);
+  // Broadphase over zone x extents, rebuilt whenever zones change
+  SpatialGrid grid;
+  void updateGrid();
+
+  void onExplosion(const Event&, const EvdGrenadeExplosion&);
+  EventManager::Handle explosionHandle;
 };
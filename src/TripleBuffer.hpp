@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free single producer, single consumer handoff of whole values.
+//
+// The producer fills the back buffer and publishes it, the consumer picks up
+// the newest published buffer whenever it's ready for one. Neither side ever
+// waits on the other: values the consumer is too slow to see are overwritten,
+// and the consumer keeps reading its current buffer until a newer one lands.
+// Buffers are reused, so values that own memory keep their capacity.
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer();
+
+  // Producer side
+  T& getWriteBuffer() { return buffers[back]; }
+  void publish();
+
+  // Consumer side. Swaps in the newest published value, returns false
+  // and keeps the current one if nothing was published since.
+  bool acquire();
+  const T& getReadBuffer() const { return buffers[front]; }
+
+private:
+  // Set on the middle index while it holds a value not yet acquired
+  static constexpr unsigned int FRESH = 1 << 2;
+
+  T buffers[3];
+
+  // Only touched by the producer and consumer respectively
+  unsigned int back;
+  unsigned int front;
+  // Index of the buffer in between, plus the FRESH bit
+  std::atomic<unsigned int> middle;
+};
+
+// IMPL
+template <typename T>
+TripleBuffer<T>::TripleBuffer() :
+  back(0),
+  front(1),
+  middle(2)
+{
+}
+
+template <typename T>
+void TripleBuffer<T>::publish()
+{
+  // Release the written value, take whatever was in the middle to write next
+  unsigned int old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+  back = old & ~FRESH;
+}
+
+template <typename T>
+bool TripleBuffer<T>::acquire()
+{
+  if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+  unsigned int old = middle.exchange(front, std::memory_order_acq_rel);
+  front = old & ~FRESH;
+
+  return true;
+}
@@ -0,0 +1,83 @@
+#include "UdpSocket.hpp"
+
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+UdpSocket::UdpSocket(unsigned short localPort) :
+  peerAddress(0),
+  peerPort(0)
+{
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    std::cout << "Error: Couldn't create UDP socket" << std::endl;
+    return;
+  }
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(localPort);
+
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    std::cout << "Error: Couldn't bind UDP port " << localPort << std::endl;
+    close(fd);
+    fd = -1;
+    return;
+  }
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+UdpSocket::~UdpSocket()
+{
+  if (fd >= 0) close(fd);
+}
+
+bool UdpSocket::setPeer(const std::string& host, unsigned short port)
+{
+  in_addr address;
+  if (inet_pton(AF_INET, host.c_str(), &address) != 1) {
+    std::cout << "Error: Bad peer address " << host << std::endl;
+    return false;
+  }
+
+  peerAddress = address.s_addr;
+  peerPort = htons(port);
+  return true;
+}
+
+void UdpSocket::send(const void* data, size_t size)
+{
+  if (fd < 0 || peerPort == 0) return;
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = peerAddress;
+  address.sin_port = peerPort;
+
+  // Dropped if the buffer is full, same as if it were lost on the way
+  sendto(fd, data, size, 0,
+      reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+size_t UdpSocket::receive(void* buffer, size_t capacity)
+{
+  if (fd < 0) return 0;
+
+  for (;;) {
+    sockaddr_in from = {};
+    socklen_t fromSize = sizeof(from);
+    ssize_t size = recvfrom(fd, buffer, capacity, 0,
+	reinterpret_cast<sockaddr*>(&from), &fromSize);
+
+    if (size <= 0) return 0;
+
+    if (from.sin_addr.s_addr == peerAddress && from.sin_port == peerPort)
+      return size;
+  }
+}
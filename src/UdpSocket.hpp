@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Non-blocking UDP socket bound to a local port, exchanging datagrams
+// with a single peer. IPv4 only.
+class UdpSocket
+{
+public:
+  UdpSocket(unsigned short localPort);
+  ~UdpSocket();
+
+  UdpSocket(const UdpSocket&) = delete;
+  UdpSocket& operator=(const UdpSocket&) = delete;
+
+  bool isOpen() const { return fd >= 0; }
+
+  // False if host isn't a dotted IPv4 address
+  bool setPeer(const std::string& host, unsigned short port);
+
+  void send(const void* data, size_t size);
+  // Size of the next datagram from the peer, 0 if there is none
+  // waiting. Datagrams from anyone else are dropped.
+  size_t receive(void* buffer, size_t capacity);
+
+private:
+  int fd;
+  // Network byte order
+  uint32_t peerAddress;
+  uint16_t peerPort;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// std140 layouts of the uniform blocks shared between shaders, with the
+// binding point each is always attached to. Must match the block
+// declarations in assets/shaders.
+
+struct MatricesBlock
+{
+  static constexpr const char* NAME = "Matrices";
+  static constexpr unsigned int BINDING = 0;
+
+  glm::mat4 projection;
+  glm::mat4 view;
+};
+
+// Per-frame constants
+struct FrameBlock
+{
+  static constexpr const char* NAME = "Frame";
+  static constexpr unsigned int BINDING = 1;
+
+  float time;
+  float _pad[3];
+};
+
+// Terrain wobbles for terrain_wobble.vert to displace the surface with
+struct WobblesBlock
+{
+  static constexpr const char* NAME = "Wobbles";
+  static constexpr unsigned int BINDING = 2;
+  static constexpr int MAX_WOBBLES = 256;
+
+  int count;
+  int _pad[3];
+  // origin, scale, reach, unused
+  glm::vec4 wobbles[MAX_WOBBLES];
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+
+// Buffer backing one of the blocks in UniformBlocks.hpp. Stays bound to
+// the block's binding point, so every shader declaring the block sees
+// each upload without any per-shader work.
+template <typename Block>
+class UniformBuffer
+{
+public:
+  UniformBuffer();
+
+  UniformBuffer(const UniformBuffer&) = delete;
+  UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+  // Only the first size bytes, when the rest is unused
+  void upload(const Block&, size_t size = sizeof(Block));
+
+private:
+  GLuint UBO;
+};
+
+// IMPL
+template <typename Block>
+UniformBuffer<Block>::UniformBuffer()
+{
+  glGenBuffers(1, &UBO);
+  glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  glBindBufferBase(GL_UNIFORM_BUFFER, Block::BINDING, UBO);
+}
+
+template <typename Block>
+void UniformBuffer<Block>::upload(const Block& block, size_t size)
+{
+  glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, size, &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -116,12 +116,13 @@ void Window::initShaders()
   shader_post = ResourceManager::GetShader("post");
   shader_blur = ResourceManager::GetShader("blur");
 
-  shader_post.use();
-  shader_post.setInt("screenTexture", 0);
-  shader_post.setInt("blurTexture", 1);
+  shader_post->use();
+  shader_post->setInt("screenTexture", 0);
+  shader_post->setInt("blurTexture", 1);
 
-  shader_blur.use();
-  shader_blur.setInt("screenTexture", 0);
+  shader_blur->use();
+  shader_blur->setInt("screenTexture", 0);
+  blurHorizontal = shader_blur->getUniform<bool>("horizontal");
 }
 
 void Window::render()
@@ -133,12 +134,12 @@ void Window::render()
   glDisable(GL_DEPTH_TEST);
 
   // Blur
-  shader_blur.use();
+  shader_blur->use();
 
   bool horizontal = false;
   bool initial = true;
   for (int i = 0; i < 2; ++i) {
-    shader_blur.setBool("horizontal", horizontal);
+    shader_blur->set(blurHorizontal, horizontal);
 
     glBindFramebuffer(GL_FRAMEBUFFER, PFBO[1+horizontal]);
     glActiveTexture(GL_TEXTURE0);
@@ -157,7 +158,7 @@ void Window::render()
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  shader_post.use();
+  shader_post->use();
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, PFBO_buffer[0]);
   glActiveTexture(GL_TEXTURE1);
@@ -37,6 +37,7 @@ private:
   unsigned int PFBO[3], PFBO_buffer[3]; // Post processing downsampled buffer
   unsigned int VAO, VBO; // final quad to draw
 
-  Shader shader_post;
-  Shader shader_blur;
+  const Shader* shader_post;
+  const Shader* shader_blur;
+  Shader::Uniform<bool> blurHorizontal;
 };
@@ -1,5 +1,6 @@
 #include "geo.hpp"
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include <iostream>
 
@@ -62,3 +63,12 @@ float geo::cross(glm::vec2 a, glm::vec2 b)
   return glm::cross(a3, b3).z;
 }
 
+float geo::mixAngle(float a, float b, float t)
+{
+  float diff = b - a;
+  if (diff > glm::pi<float>()) diff -= glm::two_pi<float>();
+  else if (diff < -glm::pi<float>()) diff += glm::two_pi<float>();
+
+  return a + t * diff;
+}
+
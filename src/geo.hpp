@@ -16,10 +16,13 @@ namespace geo {
   std::pair<bool, glm::vec2> intersect(glm::vec2, glm::vec2, glm::vec2, glm::vec2);
 
   float cross(glm::vec2, glm::vec2);
+
+  // Interpolate between two angles (radians) along the shortest arc
+  float mixAngle(float a, float b, float t);
   constexpr int uniquePair(int a, int b);
 
   template <typename T>
-    T inf() {
+    constexpr T inf() {
       return std::numeric_limits<T>::infinity();
     }
 }
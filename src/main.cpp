@@ -3,6 +3,15 @@
 
 #include <set>
 #include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <cstdlib>
 
 #include <glad/glad.h>	  // OpenGL bindings
 #include <GLFW/glfw3.h>	  // OpenGL helpers
@@ -14,30 +23,67 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "ControllerData.hpp"
+#include "InputFrame.hpp"
+#include "Replay.hpp"
+#include "Netplay.hpp"
+#include "UdpSocket.hpp"
+#include "Random.hpp"
 
 #include "Console.hpp"
 #include "Window.hpp"
 #include "ResourceManager.hpp"
-#include "Terrain.hpp"
 #include "Player.hpp"
 
-#include "EventManager.hpp"
+#include "UniformBlocks.hpp"
+#include "UniformBuffer.hpp"
 
-#include "TimescaleSystem.hpp"
+#include "Simulation.hpp"
+#include "Snapshot.hpp"
+#include "TripleBuffer.hpp"
+#include "FrameScheduler.hpp"
+#include "JobSystem.hpp"
 #include "CameraSystem.hpp"
-#include "PlayerSystem.hpp"
-#include "GrenadeSystem.hpp"
-#include "PowerupSystem.hpp"
 
 #include "Renderer/BaseRenderer.hpp"
 #include "Renderer/TextRenderer.hpp"
 #include "Renderer/PlayerRenderer.hpp"
 #include "Renderer/GrenadeRenderer.hpp"
 #include "Renderer/TerrainRenderer.hpp"
+#include "Renderer/BackgroundRenderer.hpp"
 #include "Renderer/PowerupRenderer.hpp"
 #include "Renderer/TimescaleZoneRenderer.hpp"
 
-int main() {
+namespace {
+
+// Joystick input polled on the main thread, where GLFW requires it,
+// waiting for the logic thread to apply it at its next tick
+struct PendingInput
+{
+  std::mutex mutex;
+  InputFrame frame;
+};
+
+}
+
+int main(int argc, char** argv) {
+
+  // --record <file> saves a replay of the match, see Replay.hpp
+  // --netplay <port> <peer port> <0|1> plays against another instance
+  // over UDP, see Netplay.hpp. --peer-host sets its address.
+  const char* replayPath = nullptr;
+  const char* peerHost = "127.0.0.1";
+  int netplayPort = 0, peerPort = 0, peerIndex = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--record") == 0 && i+1 < argc)
+      replayPath = argv[++i];
+    else if (std::strcmp(argv[i], "--netplay") == 0 && i+3 < argc) {
+      netplayPort = std::atoi(argv[++i]);
+      peerPort = std::atoi(argv[++i]);
+      peerIndex = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--peer-host") == 0 && i+1 < argc)
+      peerHost = argv[++i];
+  }
 
   glfwInit();
 
@@ -58,19 +104,9 @@ int main() {
   // imguiStyle->Colors[ImGuiCol_TitleBgActive] = {0.3, 0.3, 0.3, 0.9};
   // imguiStyle->Colors[ImGuiCol_Header] = {0.3, 0.3, 0.3, 0.9};
 
-  // Initialize space in UBO
-  unsigned int UBO;
-  glGenBuffers(1, &UBO);
-  glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-  glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
-  glBindBufferRange(GL_UNIFORM_BUFFER, 0, UBO, 0, sizeof(glm::mat4));
-
-  // Push initial matrices to UBO
-  glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-  glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4),
-      glm::value_ptr(glm::mat4()));
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  // Shared uniform blocks, see UniformBlocks.hpp
+  UniformBuffer<MatricesBlock> matricesBuffer;
+  UniformBuffer<FrameBlock> frameBuffer;
 
   // -----------------------------------
 
@@ -79,10 +115,12 @@ int main() {
 
   ResourceManager::LoadShader("base", "base.vert", "base.frag");
   ResourceManager::LoadShader("terrain", "terrain.vert", "terrain.frag");
+  ResourceManager::LoadShader("terrain_wobble",
+      "terrain_wobble.vert", "terrain.frag");
   ResourceManager::LoadShader("post", "screen.vert", "post.frag");
   ResourceManager::LoadShader("blur", "screen.vert", "blur.frag");
   ResourceManager::LoadShader("bg_mesh", "terrain.vert", "bg_mesh.frag");
-  ResourceManager::LoadShader("inertia_zone", "base.vert", "inertia_zone.frag");
+  ResourceManager::LoadShader("instanced", "instanced.vert", "instanced.frag");
   w.initShaders();
 
   // std::vector<glm::vec3> cm_v;
@@ -117,55 +155,167 @@ int main() {
     // Dirty hack to ignore my laptop accelerometer
     if (glfwGetJoystickName(i)[1] == 'T') continue;
 
-    controllers[i] = ControllerData();
+    // Start from the stick positions now, the logic thread may tick
+    // before the first poll
+    int count;
+    const float* axes = glfwGetJoystickAxes(i, &count);
+    controllers[i].axes.assign(axes, axes + count);
   }
 
-  // Module setup
-  TimescaleSystem timescaleSystem;
+  const double dt = 1.f/60.f; // logic tickrate
+  const int maxTicksPerFrame = 5; // catch-up limit on slow frames
+
+  // Everything random in the match follows from this, so it's all a
+  // replay needs besides input
+  unsigned int seed = std::random_device()();
+
+  // Both ends of a netplay match start from the host's seed and
+  // everyone's controllers
+  std::unique_ptr<UdpSocket> socket;
+  std::unique_ptr<NetplaySession> session;
+  if (netplayPort > 0) {
+    socket.reset(new UdpSocket(netplayPort));
+    if (!socket->isOpen() || !socket->setPeer(peerHost, peerPort)) {
+      glfwTerminate();
+      return 1;
+    }
+
+    session.reset(new NetplaySession(*socket, peerIndex, seed, controllers));
 
-  Terrain terrain;
-  PlayerSystem playerSystem(terrain, controllers, timescaleSystem);
-  GrenadeSystem grenadeSystem(terrain, timescaleSystem, playerSystem);
-  PowerupSystem powerupSystem(terrain, playerSystem);
-  CameraSystem cameraSystem(&w, playerSystem.getPlayers());
+    std::cout << "Waiting for peer on port " << peerPort << std::endl;
+    while (!session->connect()) {
+      glfwPollEvents();
+      if (glfwWindowShouldClose(w.getWindow())) {
+	glfwTerminate();
+	return 0;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    seed = session->getSeed();
+  }
+
+  Random::seed(seed);
+
+  // One worker per spare core, this thread makes up the rest
+  unsigned int cores = std::thread::hardware_concurrency();
+  JobSystem::Init(cores > 1 ? cores - 1 : 0);
+
+  std::unique_ptr<ReplayRecorder> recorder;
+  if (replayPath && session) {
+    std::cout << "Error: Can't record a netplay match" << std::endl;
+  }
+  else if (replayPath) {
+    recorder.reset(new ReplayRecorder(replayPath, seed, dt, controllers));
+  }
+
+  // Module setup
+  Simulation simulation(session ? session->getControllers() : controllers);
+  CameraSystem cameraSystem(&w, simulation.getPlayerSystem().getPlayers());
+
+  // Finished ticks are copied out for the renderers, which run on this
+  // thread while the logic thread moves on to the next tick
+  TripleBuffer<Snapshot> snapshots;
+
+  auto publishSnapshot = [&]() {
+    Snapshot& s = snapshots.getWriteBuffer();
+    simulation.writeSnapshot(s);
+    s.cameraPosition = cameraSystem.getPosition();
+    s.cameraPreviousPosition = cameraSystem.getPreviousPosition();
+    s.publishTime = glfwGetTime();
+    snapshots.publish();
+  };
+
+  simulation.start();
+  if (session) session->start(simulation, dt);
+  publishSnapshot();
+  snapshots.acquire();
 
   TextRenderer textRenderer;
-  PlayerRenderer playerRenderer(playerSystem);
-  TerrainRenderer terrainRenderer(terrain);
-  GrenadeRenderer grenadeRenderer(grenadeSystem);
-  PowerupRenderer powerupRenderer(powerupSystem);
-  TimescaleZoneRenderer timescaleZoneRenderer(timescaleSystem);
+  PlayerRenderer playerRenderer;
+  // Terrain wobbles are displaced in the vertex shader
+  TerrainRenderer terrainRenderer(snapshots.getReadBuffer(), true);
+  BackgroundRenderer backgroundRenderer(snapshots.getReadBuffer());
+  GrenadeRenderer grenadeRenderer;
+  PowerupRenderer powerupRenderer;
+  TimescaleZoneRenderer timescaleZoneRenderer;
+
+  // Logic loop
+  //////////////////////////////////////////
+
+  PendingInput input;
+  std::atomic<bool> running(true);
+
+  std::thread logicThread([&]() {
+      FrameScheduler scheduler(dt, maxTicksPerFrame);
+      double t = glfwGetTime();
+
+      InputFrame frame;
+
+      while (running) {
+	double newTime = glfwGetTime();
+	double frameTime = newTime - t;
+	t = newTime;
+
+	// Late remote input can rewrite ticks already published
+	unsigned long rollbacks = 0;
+	if (session) {
+	  session->update();
+	  rollbacks = session->getRollbackCount();
+	}
 
-  // Main loop
-  const double dt = 1.f/60.f; // logic tickrate
+	int ticks = scheduler.advance(frameTime);
+	for (int tick = 0; tick < ticks; ++tick) {
+
+	  // Too far ahead of the peer, drop the tick and let it catch up
+	  if (session && !session->canAdvance()) break;
+
+	  // Player input
+	  {
+	    std::lock_guard<std::mutex> lock(input.mutex);
+	    std::swap(frame, input.frame);
+	  }
 
-  double t = glfwGetTime();
-  double sim_t = 0.f;
-  double accumulator = 0.0;
+	  if (session) {
+	    session->advance(frame);
+	  }
+	  else {
+	    if (recorder) recorder->record(simulation.getTickCount(), frame);
+	    simulation.applyInput(frame);
+
+	    // Tick update
+	    simulation.tick(dt);
+	  }
+	  frame.clear();
+
+	  // Once per tick actually advanced. Not a simulation task, so it
+	  // isn't run again for ticks resimulated by a rollback.
+	  cameraSystem.update(simulation.getTime(), simulation.getDeltaTime());
+	}
 
-  EventManager::Send(Event::GAME_START);
+	if (ticks > 0 || (session && session->getRollbackCount() != rollbacks))
+	  publishSnapshot();
 
+	// Sleep until the next tick is due
+	double wait = (1.0 - scheduler.getAlpha()) * dt;
+	std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+      }
+      });
+
+  // Main loop
   while (!glfwWindowShouldClose(w.getWindow())) {
 
     // ImGui_ImplGlfwGL3_NewFrame();
     // Console::render();
 
-    double newTime = glfwGetTime();
-    double frameTime = newTime - t;
-    t = newTime;
-    accumulator += frameTime;
-
-    // Logic tick
-    // WARNING: "if" rather than "while" can cause spiral of death
-    if (accumulator >= dt) {
-      accumulator -= dt;
-
-      double sim_dt = timescaleSystem.getGlobalTimescale() * dt;
-      sim_t += sim_dt;
+    // Player input
+    //////////////////////////////////////////
 
-      // Player input
-      //////////////////////////////////////////
+    {
+      std::lock_guard<std::mutex> lock(input.mutex);
 
+      // Only tracks which buttons are held, the logic thread
+      // keeps its own copy of each controller
       for (auto& p : controllers) {
 
 	int count;
@@ -178,53 +328,55 @@ int main() {
 	  // Press event
 	  if (buttonDown && !p.second.buttons.count(i)) {
 	    p.second.buttons.insert(i);
-	    playerSystem.processInput(p.first, i, true);
+	    input.frame.buttons.push_back({p.first, i, true});
 	  }
 
 	  // Release event
 	  else if (!buttonDown && p.second.buttons.count(i)) {
 	    p.second.buttons.erase(i);
-	    playerSystem.processInput(p.first, i, false);
+	    input.frame.buttons.push_back({p.first, i, false});
 	  }
 	}
 
 	const float* axes = glfwGetJoystickAxes(p.first, &count);
-	p.second.axes.assign(axes, axes + count);
+	input.frame.axes[p.first].assign(axes, axes + count);
       }
-
-      // Tick update
-      EventManager::Update(sim_t, sim_dt);
-      timescaleSystem.update(t, dt);
-
-      grenadeSystem.update(sim_dt);
-      powerupSystem.update(sim_dt);
-      terrain.update(sim_t, sim_dt);
-      playerSystem.update(sim_t, sim_dt);
-
-      // Camera movement
-      cameraSystem.update(sim_t, sim_dt);
     }
 
     /////////
     // Render
     /////////
 
+    // Newest finished tick, or the last one again if there's no new one
+    snapshots.acquire();
+    const Snapshot& snapshot = snapshots.getReadBuffer();
+    BaseRenderer::SetSnapshot(&snapshot);
+
     // First pass
     glBindFramebuffer(GL_FRAMEBUFFER, w.getFBO());
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.2f, 0.25f, 0.6f, 0.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // Blend from the tick before the snapshot by the time since it was
+    // published, the logic thread is a tick ahead of what's drawn
+    double now = glfwGetTime();
+    float alpha = (now - snapshot.publishTime) / dt;
+    if (alpha > 1.f) alpha = 1.f;
+    if (alpha < 0.f) alpha = 0.f;
+    BaseRenderer::SetAlpha(alpha);
+
     // Camera
-    glm::mat4 projection = cameraSystem.getProjection();
-    glm::mat4 view = cameraSystem.getView();
+    MatricesBlock matrices;
+    matrices.projection = cameraSystem.getProjection();
+    matrices.view = CameraSystem::GetView(snapshot, alpha);
+    matricesBuffer.upload(matrices);
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4),
-	glm::value_ptr(projection));
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4),
-	glm::value_ptr(view));
+    FrameBlock frame;
+    frame.time = now;
+    frameBuffer.upload(frame);
 
+    backgroundRenderer.draw();
     terrainRenderer.draw();
     playerRenderer.draw();
     grenadeRenderer.draw();
@@ -248,6 +400,10 @@ int main() {
   // Cleanup
   // ImGui_ImplGlfwGL3_Shutdown();
   // ImGui::DestroyContext();
+  running = false;
+  logicThread.join();
+  if (recorder) recorder->finish(simulation.getTickCount());
+  JobSystem::Shutdown();
   glfwTerminate();
 
   return 0;
@@ -0,0 +1,518 @@
+// Headless simulation runner.
+//
+// Runs full matches without a window or GL context, ticking as fast as the
+// CPU allows. Players are driven by simple random bots.
+//
+// Usage: grenadiers_sim [--queued] [matches] [seconds per match] [players]
+//        grenadiers_sim --bench [grenades] [ticks]
+//        grenadiers_sim --replay <file> [--rollback N]
+//        grenadiers_sim --netplay <port> <peer port> <peer index>
+//                       [seconds] [players]
+//
+// --threads N runs N job system workers alongside the main thread.
+// --queued defers event dispatch to the end of each tick and counts the
+// events flushed.
+// --record <file> saves the first match as a replay.
+// --bench times GrenadeSystem::update alone, keeping the given number of
+// cluster fragments in flight over an empty map.
+// --replay plays a recorded match back as fast as possible, timing each
+// tick and reporting the slowest, to profile a hitch repeatably.
+// --rollback N replays as if every tick's input arrived N ticks late:
+// each tick restores the state from N ticks back and runs them again.
+// The checksum should match a plain replay.
+// --netplay plays one match against another grenadiers_sim over UDP, see
+// Netplay.hpp, with bots on both ends and no pacing. Start one as peer 0
+// and one as peer 1 with the ports swapped; once both finish they print
+// the same checksum. --peer-host sets the peer's address, default
+// 127.0.0.1.
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <thread>
+
+#include "ControllerData.hpp"
+#include "InputFrame.hpp"
+#include "Replay.hpp"
+#include "Netplay.hpp"
+#include "UdpSocket.hpp"
+#include "Joystick.hpp"
+#include "Random.hpp"
+#include "EventManager.hpp"
+#include "JobSystem.hpp"
+#include "Simulation.hpp"
+#include "SimulationState.hpp"
+#include "TimescaleSystem.hpp"
+#include "Terrain.hpp"
+#include "PlayerSystem.hpp"
+#include "GrenadeSystem.hpp"
+
+namespace {
+
+const double dt = 1.f/60.f; // logic tickrate
+
+// Bots make their choices from their own stream, so they don't shift
+// the simulation's numbers and a recorded match replays the same
+// without them
+RandomStream botRandom(0, Random::BOTS);
+
+// Crude stand-in for a human player: wanders, jumps and throws at random
+struct Bot
+{
+  int controllerID;
+  int ticksUntilMove = 0;
+  int ticksUntilThrow = 0;
+  float moveX = 0.f;
+  float moveY = 0.f;
+};
+
+void setButton(const std::map<int, ControllerData>& controllers,
+    InputFrame& frame, int controllerID, int button, bool down)
+{
+  const ControllerData& c = controllers.at(controllerID);
+
+  if (down != (c.buttons.count(button) > 0)) {
+    frame.buttons.push_back({controllerID, button, down});
+  }
+}
+
+// Controllers as the bot's input will find them
+void updateBot(const std::map<int, ControllerData>& controllers,
+    InputFrame& frame, Bot& b)
+{
+  if (--b.ticksUntilMove <= 0) {
+    b.ticksUntilMove = botRandom.randomInt(10, 90);
+    b.moveX = botRandom.randomFloat(-1.f, 1.f);
+    b.moveY = botRandom.randomFloat(-1.f, 1.f);
+  }
+
+  std::vector<float>& axes = frame.axes[b.controllerID];
+  axes = controllers.at(b.controllerID).axes;
+  axes[0] = b.moveX;
+  axes[1] = b.moveY;
+
+  setButton(controllers, frame, b.controllerID, JOY_BUTTON_A,
+      botRandom.randomInt(0, 60) == 0);
+  setButton(controllers, frame, b.controllerID, JOY_BUTTON_Y,
+      botRandom.randomInt(0, 120) == 0);
+  setButton(controllers, frame, b.controllerID, JOY_BUTTON_LB,
+      botRandom.randomInt(0, 30) == 0);
+
+  // Hold RB for a few ticks, release to throw
+  if (--b.ticksUntilThrow <= 0) {
+    b.ticksUntilThrow = botRandom.randomInt(20, 80);
+  }
+  setButton(controllers, frame, b.controllerID, JOY_BUTTON_RB, b.ticksUntilThrow > 5);
+}
+
+// Cheap fingerprint of the match state, equal across runs only if
+// they played out the same
+unsigned long checksum(const Simulation& sim)
+{
+  unsigned long h = 14695981039346656037ul;
+  auto mix = [&h](float f) {
+    unsigned int bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    h = (h ^ bits) * 1099511628211ul;
+  };
+
+  for (const auto& p : sim.getPlayerSystem().getPlayers()) {
+    mix(p.position.x);
+    mix(p.position.y);
+    mix(p.health);
+  }
+
+  const GrenadePool& grenades = sim.getGrenadeSystem().getGrenades();
+  for (size_t i = 0; i < grenades.size(); ++i) {
+    mix(grenades.position[i].x);
+    mix(grenades.position[i].y);
+  }
+
+  return h;
+}
+
+int runReplay(const char* path, int rollback)
+{
+  ReplayPlayer replay(path);
+  if (!replay.isOpen()) return 1;
+
+  Random::seed(replay.getSeed());
+
+  Simulation simulation(replay.getControllers());
+  simulation.start();
+
+  InputFrame frame;
+  std::vector<double> tickTimes;
+
+  // State before each of the last rollback+1 ticks, and its input
+  size_t historySize = rollback + 1;
+  std::vector<SimulationState> states(historySize);
+  std::vector<InputFrame> frames(historySize);
+  double saveTime = 0.0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  while (replay.read(simulation.getTickCount(), frame)) {
+    auto tickStart = std::chrono::steady_clock::now();
+
+    if (rollback > 0) {
+      unsigned long tick = simulation.getTickCount();
+      simulation.saveState(states[tick % historySize]);
+      frames[tick % historySize] = frame;
+
+      auto saveEnd = std::chrono::steady_clock::now();
+      saveTime += std::chrono::duration<double>(saveEnd - tickStart).count();
+
+      if (tick >= (unsigned long)rollback) {
+	simulation.restoreState(states[(tick - rollback) % historySize]);
+	for (unsigned long t = tick - rollback; t < tick; ++t) {
+	  simulation.applyInput(frames[t % historySize]);
+	  simulation.tick(replay.getTickLength());
+	}
+      }
+    }
+
+    simulation.applyInput(frame);
+    simulation.tick(replay.getTickLength());
+
+    auto tickEnd = std::chrono::steady_clock::now();
+    tickTimes.push_back(
+	std::chrono::duration<double>(tickEnd - tickStart).count());
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(end - start).count();
+
+  std::cout << tickTimes.size() << " ticks in " << elapsed << "s ("
+    << tickTimes.size() / elapsed << " ticks/s)" << std::endl;
+
+  if (rollback > 0) {
+    std::cout << "Rolled back " << rollback << " ticks every tick, "
+      << saveTime / tickTimes.size() * 1e6 << "us/tick saving state"
+      << std::endl;
+  }
+
+  // Slowest ticks first
+  std::vector<size_t> order(tickTimes.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  size_t numSlowest = order.size() < 5 ? order.size() : 5;
+  std::partial_sort(order.begin(), order.begin() + numSlowest, order.end(),
+      [&](size_t a, size_t b) { return tickTimes[a] > tickTimes[b]; });
+
+  for (size_t i = 0; i < numSlowest; ++i) {
+    std::cout << "  tick " << order[i] << ": "
+      << tickTimes[order[i]] * 1000.0 << "ms" << std::endl;
+  }
+
+  std::cout << "State checksum " << std::hex << checksum(simulation)
+    << std::dec << std::endl;
+
+  return 0;
+}
+
+int runNetplay(unsigned short port, const char* peerHost,
+    unsigned short peerPort, int peerIndex, double matchLength, int numPlayers)
+{
+  UdpSocket socket(port);
+  if (!socket.isOpen() || !socket.setPeer(peerHost, peerPort)) return 1;
+
+  std::map<int, ControllerData> local;
+  std::vector<Bot> bots;
+
+  for (int i = 0; i < numPlayers; ++i) {
+    local[i].axes.assign(6, 0.f);
+
+    Bot b;
+    b.controllerID = i;
+    bots.push_back(b);
+  }
+
+  // So the two peers' bots don't play the same
+  botRandom = RandomStream(peerIndex, Random::BOTS);
+
+  NetplaySession session(socket, peerIndex, std::random_device()(), local);
+
+  std::cout << "Waiting for peer on port " << peerPort << std::endl;
+  while (!session.connect()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  Random::seed(session.getSeed());
+  Simulation simulation(session.getControllers());
+  simulation.start();
+  session.start(simulation, dt);
+
+  unsigned long ticksPerMatch = matchLength / dt + 0.5;
+  InputFrame frame;
+
+  auto start = std::chrono::steady_clock::now();
+
+  while (simulation.getTickCount() < ticksPerMatch || !session.isSynced()) {
+    session.update();
+
+    if (simulation.getTickCount() >= ticksPerMatch || !session.canAdvance()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    frame.clear();
+    for (auto& b : bots) updateBot(session.getLocalControllers(), frame, b);
+    session.advance(frame);
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(end - start).count();
+
+  // Keep sending for a moment, in case the peer still misses our last input
+  auto lingerEnd = end + std::chrono::milliseconds(500);
+  while (std::chrono::steady_clock::now() < lingerEnd) {
+    session.update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  std::cout << simulation.getTickCount() << " ticks in " << elapsed << "s, "
+    << session.getRollbackCount() << " rollbacks, "
+    << session.getResimulatedTicks() << " ticks resimulated, "
+    << "deepest " << session.getMaxRollback() << std::endl;
+
+  std::cout << "State checksum " << std::hex << checksum(simulation)
+    << std::dec << std::endl;
+
+  return 0;
+}
+
+void spawnFragment(GrenadeSystem& grenadeSystem, float maxX)
+{
+  Grenade g(Grenade::Type::CLUSTER_FRAGMENT);
+  g.position.x = Random::randomFloat(0.f, maxX);
+  g.position.y = Random::randomFloat(1000.f, 4000.f);
+  g.velocity.x = Random::randomFloat(-230.f, 230.f);
+  g.velocity.y = Random::randomFloat(200.f, 400.f);
+  grenadeSystem.spawnGrenade(g);
+}
+
+int runBench(int numGrenades, int numTicks)
+{
+  // No controllers, so only the dummy player
+  std::map<int, ControllerData> controllers;
+
+  TimescaleSystem timescaleSystem;
+  Terrain terrain;
+  PlayerSystem playerSystem(terrain, controllers, timescaleSystem);
+  GrenadeSystem grenadeSystem(terrain, timescaleSystem, playerSystem);
+
+  for (int i = 0; i < numGrenades; ++i)
+    spawnFragment(grenadeSystem, terrain.getMaxWidth());
+
+  double time = 0.0;
+  double updateTime = 0.0;
+  unsigned long grenadeUpdates = 0;
+
+  for (int t = 0; t < numTicks; ++t) {
+    time += dt;
+    EventManager::Update(time, dt);
+
+    auto start = std::chrono::steady_clock::now();
+    grenadeSystem.update(dt);
+    auto end = std::chrono::steady_clock::now();
+
+    updateTime += std::chrono::duration<double>(end - start).count();
+    grenadeUpdates += grenadeSystem.getGrenades().size();
+
+    terrain.update(time, dt);
+
+    // Replace the fragments that landed
+    const GrenadePool& grenades = grenadeSystem.getGrenades();
+    int alive = 0;
+    for (size_t i = 0; i < grenades.size(); ++i)
+      if (!grenades.hasFlag(i, GrenadePool::AWAITING_REMOVAL)) alive++;
+
+    for (int i = alive; i < numGrenades; ++i)
+      spawnFragment(grenadeSystem, terrain.getMaxWidth());
+  }
+
+  std::cout << numTicks << " updates of " << numGrenades << " grenades in "
+    << updateTime << "s (" << updateTime / numTicks * 1000.0 << "ms/update, "
+    << grenadeUpdates / updateTime / 1e6 << "M grenades/s)" << std::endl;
+
+  return 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  bool queued = false;
+  bool bench = false;
+  const char* recordPath = nullptr;
+  const char* replayPath = nullptr;
+  int numWorkers = 0;
+  int rollback = 0;
+  const char* peerHost = "127.0.0.1";
+  int netplayPort = 0, peerPort = 0, peerIndex = -1;
+  std::vector<const char*> args;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--queued") == 0) queued = true;
+    else if (std::strcmp(argv[i], "--bench") == 0) bench = true;
+    else if (std::strcmp(argv[i], "--threads") == 0 && i+1 < argc)
+      numWorkers = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--record") == 0 && i+1 < argc)
+      recordPath = argv[++i];
+    else if (std::strcmp(argv[i], "--replay") == 0 && i+1 < argc)
+      replayPath = argv[++i];
+    else if (std::strcmp(argv[i], "--rollback") == 0 && i+1 < argc)
+      rollback = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--netplay") == 0 && i+3 < argc) {
+      netplayPort = std::atoi(argv[++i]);
+      peerPort = std::atoi(argv[++i]);
+      peerIndex = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--peer-host") == 0 && i+1 < argc)
+      peerHost = argv[++i];
+    else args.push_back(argv[i]);
+  }
+
+  if (bench) {
+    int numGrenades = args.size() > 0 ? std::atoi(args[0]) : 10000;
+    int numTicks = args.size() > 1 ? std::atoi(args[1]) : 600;
+
+    if (numGrenades < 1 || numTicks < 1) {
+      std::cout << "Usage: " << argv[0]
+	<< " --bench [grenades] [ticks]" << std::endl;
+      return 1;
+    }
+
+    JobSystem::Init(numWorkers > 0 ? numWorkers : 0);
+    int result = runBench(numGrenades, numTicks);
+    JobSystem::Shutdown();
+
+    return result;
+  }
+
+  if (replayPath) {
+    JobSystem::Init(numWorkers > 0 ? numWorkers : 0);
+    int result = runReplay(replayPath, rollback > 0 ? rollback : 0);
+    JobSystem::Shutdown();
+
+    return result;
+  }
+
+  if (netplayPort > 0) {
+    double matchLength = args.size() > 0 ? std::atof(args[0]) : 60.0;
+    int numPlayers = args.size() > 1 ? std::atoi(args[1]) : 2;
+
+    if (peerPort <= 0 || (peerIndex != 0 && peerIndex != 1) ||
+	matchLength <= 0.0 || numPlayers < 1 ||
+	numPlayers > NetplaySession::CONTROLLERS_PER_PEER) {
+      std::cout << "Usage: " << argv[0]
+	<< " --netplay <port> <peer port> <0|1> [seconds] [players]"
+	<< std::endl;
+      return 1;
+    }
+
+    JobSystem::Init(numWorkers > 0 ? numWorkers : 0);
+    int result = runNetplay(netplayPort, peerHost, peerPort, peerIndex,
+	matchLength, numPlayers);
+    JobSystem::Shutdown();
+
+    return result;
+  }
+
+  int numMatches = args.size() > 0 ? std::atoi(args[0]) : 10;
+  double matchLength = args.size() > 1 ? std::atof(args[1]) : 60.0;
+  int numPlayers = args.size() > 2 ? std::atoi(args[2]) : 4;
+
+  if (numMatches < 1 || matchLength <= 0.0 || numPlayers < 1) {
+    std::cout << "Usage: " << argv[0]
+      << " [--queued] [matches] [seconds per match] [players]" << std::endl;
+    return 1;
+  }
+
+  JobSystem::Init(numWorkers > 0 ? numWorkers : 0);
+
+  unsigned long numEvents = 0;
+  if (queued) {
+    EventManager::SetQueued(true);
+    EventManager::SetRecorder([&numEvents](const EventManager::QueuedEvent&) {
+	numEvents++;
+	});
+  }
+
+  unsigned long ticksPerMatch = matchLength / dt + 0.5;
+  unsigned long totalTicks = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (int m = 0; m < numMatches; ++m) {
+    std::map<int, ControllerData> controllers;
+    std::vector<Bot> bots;
+
+    for (int i = 0; i < numPlayers; ++i) {
+      controllers[i].axes.assign(6, 0.f);
+
+      Bot b;
+      b.controllerID = i;
+      bots.push_back(b);
+    }
+
+    std::unique_ptr<ReplayRecorder> recorder;
+    if (recordPath && m == 0) {
+      unsigned int seed = std::random_device()();
+      Random::seed(seed);
+      recorder.reset(new ReplayRecorder(recordPath, seed, dt, controllers));
+    }
+
+    Simulation simulation(controllers);
+    simulation.start();
+
+    size_t peakGrenades = 0;
+    InputFrame frame;
+
+    for (unsigned long t = 0; t < ticksPerMatch; ++t) {
+      frame.clear();
+      for (auto& b : bots) updateBot(simulation.getControllers(), frame, b);
+
+      if (recorder) recorder->record(simulation.getTickCount(), frame);
+      simulation.applyInput(frame);
+      simulation.tick(dt);
+
+      size_t numGrenades = simulation.getGrenadeSystem().getGrenades().size();
+      if (numGrenades > peakGrenades) peakGrenades = numGrenades;
+    }
+
+    totalTicks += simulation.getTickCount();
+
+    if (recorder) {
+      recorder->finish(simulation.getTickCount());
+      std::cout << "Recorded match 1, state checksum " << std::hex
+	<< checksum(simulation) << std::dec << std::endl;
+    }
+
+    std::cout << "Match " << m+1 << "/" << numMatches << ": "
+      << simulation.getTickCount() << " ticks, "
+      << "peak " << peakGrenades << " grenades, "
+      << EventManager::GetListenerCount() << " listeners" << std::endl;
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(end - start).count();
+
+  std::cout << "----" << std::endl;
+  std::cout << totalTicks << " ticks in " << elapsed << "s ("
+    << totalTicks / elapsed << " ticks/s, "
+    << numMatches / elapsed * 60.0 << " matches/min)" << std::endl;
+
+  if (queued) {
+    std::cout << numEvents << " queued events" << std::endl;
+  }
+
+  JobSystem::Shutdown();
+
+  return 0;
+}